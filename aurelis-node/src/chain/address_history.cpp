@@ -0,0 +1,105 @@
+#include "chain/address_history.hpp"
+#include "util/mapped_file.hpp"
+#include "util/serialize.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace aurelis {
+
+AddressHistory::AddressHistory(const std::string& p) : path(p), file(nullptr), bestHeight(-1) {}
+
+AddressHistory::~AddressHistory() {
+    if (file) fclose(file);
+}
+
+int AddressHistory::Open(int tipHeight) {
+    if (file) fclose(file);
+    file = nullptr;
+    history.clear();
+    bestHeight = -1;
+
+    // Keep whole blocks up to the tip, minus the last one (see TxIndex)
+    size_t keepBytes = 0;
+    {
+        MappedFile map;
+        if (map.Open(path)) {
+            Deserializer d(map.data(), map.size());
+            int lastHeight = -1;
+            try {
+                while (d.remaining() > 0) {
+                    size_t recordStart = d.pos;
+                    int32_t height;
+                    uint32_t index;
+                    uint32_t keyLen;
+                    d >> height >> index >> keyLen;
+                    if (keyLen > d.remaining() || height > tipHeight || height < lastHeight) break;
+                    d.pos += keyLen;
+                    if (height != lastHeight) {
+                        keepBytes = recordStart;
+                        bestHeight = lastHeight;
+                        lastHeight = height;
+                    }
+                }
+            } catch (const std::exception&) {
+                // torn trailing record
+            }
+
+            Deserializer r(map.data(), keepBytes);
+            while (r.remaining() > 0) {
+                int32_t height;
+                uint32_t index;
+                uint32_t keyLen;
+                r >> height >> index >> keyLen;
+                std::string key((const char*)r.data + r.pos, keyLen);
+                r.pos += keyLen;
+                history[key].push_back(TxLocation(height, index));
+            }
+        }
+    }
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) std::filesystem::resize_file(path, keepBytes, ec);
+    file = fopen(path.c_str(), "ab");
+    if (!file) std::cout << "[HISTORY] Cannot open " << path << " for writing" << std::endl;
+    return bestHeight;
+}
+
+void AddressHistory::AddBlock(const Block& block, int height) {
+    Serializer s;
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < block.vtx.size(); ++i) {
+        const Transaction& tx = block.vtx[i];
+        keys.clear();
+        for (const auto& in : tx.vin) keys.emplace_back((const char*)in.scriptSig.data(), in.scriptSig.size());
+        for (const auto& out : tx.vout) keys.emplace_back((const char*)out.scriptPubKey.data(), out.scriptPubKey.size());
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        for (const auto& key : keys) {
+            history[key].push_back(TxLocation(height, i));
+            s << (int32_t)height << i << (uint32_t)key.size();
+            s.write(key.data(), key.size());
+        }
+    }
+    bestHeight = height;
+    if (file && (fwrite(s.buffer.data(), 1, s.buffer.size(), file) != s.buffer.size() || fflush(file) != 0)) {
+        std::cout << "[HISTORY] Write failed at height " << height << std::endl;
+    }
+}
+
+std::vector<TxLocation> AddressHistory::GetPage(const std::string& address, uint64_t cursor, size_t count, uint64_t& next) const {
+    std::vector<TxLocation> page;
+    next = 0;
+    auto it = history.find(address);
+    if (it == history.end()) return page;
+
+    const std::vector<TxLocation>& entries = it->second;
+    uint64_t end = std::min<uint64_t>(cursor, entries.size());
+    uint64_t begin = end > count ? end - count : 0;
+    for (uint64_t i = end; i > begin; --i) page.push_back(entries[i - 1]);
+    next = begin;
+    return page;
+}
+
+} // namespace aurelis
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "chain/block.hpp"
+#include "chain/txindex.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aurelis {
+
+// Address -> confirmed transactions touching it, oldest first.
+//
+// A transaction touches an address when one of its inputs is signed by it
+// (scriptSig) or one of its outputs pays it (scriptPubKey). Positions are
+// stable because history is only ever appended, so a position doubles as a
+// pagination cursor. Mirrored to an append-only file of
+// (height, index, address) records, one batch per connected block. Not
+// thread-safe: BlockChain calls it under chainMutex.
+class AddressHistory {
+public:
+    explicit AddressHistory(const std::string& path);
+    ~AddressHistory();
+
+    AddressHistory(const AddressHistory&) = delete;
+    AddressHistory& operator=(const AddressHistory&) = delete;
+
+    // Same contract as TxIndex::Open.
+    int Open(int tipHeight);
+
+    void AddBlock(const Block& block, int height);
+
+    // Up to `count` entries older than position `cursor` (all entries when
+    // cursor exceeds the history size), newest first. `next` is the cursor
+    // for the following page, or 0 when the oldest entry was returned.
+    std::vector<TxLocation> GetPage(const std::string& address, uint64_t cursor, size_t count, uint64_t& next) const;
+
+    int Height() const { return bestHeight; }
+
+private:
+    std::string path;
+    FILE* file;
+    int bestHeight;
+    std::unordered_map<std::string, std::vector<TxLocation>> history;
+};
+
+} // namespace aurelis
@@ -1,15 +1,28 @@
 #include "chain/block.hpp"
 
-#include "util/sha256.hpp"
+#include "util/hash_writer.hpp"
 
 namespace aurelis {
 
 uint256 BlockHeader::GetHash() const {
-    Serializer s;
-    s << *this;
     uint256 hash;
-    Hash256(s.buffer.data(), s.buffer.size(), hash.data.data());
+    if (hashCache.Get(hash)) return hash;
+    HashWriter hw;
+    hw << *this;
+    hash = hw.GetHash();
+    hashCache.Set(hash);
     return hash;
 }
 
+uint256 ComputeMerkleRoot(const std::vector<Transaction>& vtx) {
+    if (vtx.empty()) return uint256();
+    if (vtx.size() == 1) return vtx[0].GetHash();
+    HashWriter hw;
+    for (const auto& tx : vtx) {
+        uint256 h = tx.GetHash();
+        hw.write(h.data.data(), h.data.size());
+    }
+    return hw.GetHash();
+}
+
 }
@@ -18,7 +18,8 @@ public:
 
     BlockHeader() : version(1), timestamp(0), bits(0), nonce(0) {}
 
-    void Serialize(Serializer& s) const {
+    template<typename Stream>
+    void Serialize(Stream& s) const {
         s << version;
         s.write(prev_block.data.data(), prev_block.data.size());
         s.write(merkle_root.data.data(), merkle_root.data.size());
@@ -34,9 +35,15 @@ public:
         d >> timestamp;
         d >> bits;
         d >> nonce;
+        hashCache.Reset();
     }
     
+    // Block hash, computed on first use and cached (see CachedHash)
     uint256 GetHash() const;
+    void InvalidateHash() const { hashCache.Reset(); }
+
+private:
+    CachedHash hashCache;
 };
 
 class Block {
@@ -44,7 +51,8 @@ public:
     BlockHeader header;
     std::vector<Transaction> vtx;
 
-    void Serialize(Serializer& s) const {
+    template<typename Stream>
+    void Serialize(Stream& s) const {
         s << header;
         s << vtx;
     }
@@ -55,4 +63,8 @@ public:
     }
 };
 
+// Aurelis merkle commitment: the txid itself for a single transaction,
+// otherwise Hash256 over the concatenated txids. Zero for an empty list.
+uint256 ComputeMerkleRoot(const std::vector<Transaction>& vtx);
+
 } // namespace aurelis
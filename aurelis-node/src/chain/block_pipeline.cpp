@@ -0,0 +1,171 @@
+#include "chain/block_pipeline.hpp"
+#include "util/bounded_queue.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aurelis {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct DecodeJob {
+    size_t seq;
+    BlockRecord rec;
+};
+
+struct Slot {
+    bool ready = false;
+    bool ok = false;
+    DecodedBlock decoded;
+};
+
+bool DecodeRecord(const BlockRecord& rec, DecodedBlock& out) {
+    out.hash = rec.hash;
+    try {
+        Deserializer d(rec.data, rec.length);
+        d >> out.block;
+    } catch (const std::exception&) {
+        std::cout << "[LOAD] Unreadable block " << rec.hash.ToString() << std::endl;
+        return false;
+    }
+    if (out.block.header.GetHash() != rec.hash) {
+        std::cout << "[LOAD] Block " << rec.hash.ToString() << " does not match its index entry" << std::endl;
+        return false;
+    }
+    // Fills every txid cache, so the applier never hashes
+    if (ComputeMerkleRoot(out.block.vtx) != out.block.header.merkle_root) {
+        std::cout << "[LOAD] Merkle root mismatch in block " << rec.hash.ToString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+PipelineStats ReplayBlocks(const BlockStore& store, size_t first, int workers,
+                           const std::function<bool(DecodedBlock&)>& apply) {
+    PipelineStats stats;
+    stats.workers = workers < 1 ? 1 : workers;
+    const size_t window = std::max<size_t>(64, (size_t)stats.workers * 16);
+    Clock::time_point wallStart = Clock::now();
+
+    BoundedQueue<DecodeJob> jobs(window);
+    std::vector<Slot> slots(window);
+    std::mutex slotMutex;
+    std::condition_variable slotReady;
+    std::condition_variable slotFree;
+    size_t nextApply = 0;
+    size_t produced = 0;
+    bool readerDone = false;
+    bool stop = false;
+
+    std::thread reader([&]() {
+        Clock::time_point start = Clock::now();
+        double waited = 0;
+        size_t seq = 0;
+        store.ForEachRecord([&](const BlockRecord& rec) {
+            Clock::time_point waitStart = Clock::now();
+            {
+                std::unique_lock<std::mutex> lock(slotMutex);
+                slotFree.wait(lock, [&] { return stop || seq < nextApply + window; });
+                if (stop) return false;
+            }
+            bool pushed = jobs.Push(DecodeJob{seq, rec});
+            waited += SecondsSince(waitStart);
+            if (!pushed) return false;
+            stats.bytes += rec.length;
+            seq++;
+            return true;
+        }, first);
+        jobs.Close();
+        std::lock_guard<std::mutex> lock(slotMutex);
+        produced = seq;
+        readerDone = true;
+        stats.readSeconds = SecondsSince(start) - waited;
+        slotReady.notify_all();
+    });
+
+    std::vector<std::thread> decoders;
+    for (int i = 0; i < stats.workers; ++i) {
+        decoders.emplace_back([&]() {
+            double busy = 0;
+            DecodeJob job;
+            while (jobs.Pop(job)) {
+                Clock::time_point start = Clock::now();
+                DecodedBlock decoded;
+                bool ok = DecodeRecord(job.rec, decoded);
+                job.rec.file.reset();
+                busy += SecondsSince(start);
+
+                {
+                    std::lock_guard<std::mutex> lock(slotMutex);
+                    Slot& slot = slots[job.seq % window];
+                    std::swap(slot.decoded, decoded);
+                    slot.ok = ok;
+                    slot.ready = true;
+                    slotReady.notify_all();
+                }
+                // `decoded` now holds the block the applier handed back for
+                // this slot; free it here rather than on the applier thread
+                Clock::time_point freeStart = Clock::now();
+                decoded = DecodedBlock();
+                busy += SecondsSince(freeStart);
+            }
+            std::lock_guard<std::mutex> lock(slotMutex);
+            stats.decodeSeconds += busy;
+        });
+    }
+
+    // Applier: consume slots strictly in sequence
+    for (;;) {
+        DecodedBlock decoded;
+        {
+            std::unique_lock<std::mutex> lock(slotMutex);
+            slotReady.wait(lock, [&] {
+                return slots[nextApply % window].ready || (readerDone && nextApply >= produced);
+            });
+            Slot& slot = slots[nextApply % window];
+            if (!slot.ready || !slot.ok) break;
+            decoded = std::move(slot.decoded);
+            slot.ready = false;
+        }
+
+        Clock::time_point start = Clock::now();
+        size_t txs = decoded.block.vtx.size();
+        bool keepGoing = apply(decoded);
+        stats.applySeconds += SecondsSince(start);
+        if (!keepGoing) break;
+        stats.blocks++;
+        stats.txs += txs;
+
+        // Hand the spent block back to its slot so a decoder frees it
+        std::lock_guard<std::mutex> lock(slotMutex);
+        slots[nextApply % window].decoded = std::move(decoded);
+        nextApply++;
+        slotFree.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        stop = true;
+        slotFree.notify_all();
+    }
+    jobs.Close();
+    reader.join();
+    for (auto& t : decoders) t.join();
+
+    stats.wallSeconds = SecondsSince(wallStart);
+    return stats;
+}
+
+} // namespace aurelis
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "chain/blockstore.hpp"
+#include <cstddef>
+#include <functional>
+
+namespace aurelis {
+
+struct DecodedBlock {
+    uint256 hash;
+    Block block;
+};
+
+// Per-stage counters of a ReplayBlocks run. Stage times are busy time with
+// queue waits excluded; decodeSeconds is summed over all decode workers.
+struct PipelineStats {
+    size_t blocks = 0;
+    size_t txs = 0;
+    size_t bytes = 0;
+    int workers = 0;
+    double readSeconds = 0;
+    double decodeSeconds = 0;
+    double applySeconds = 0;
+    double wallSeconds = 0;
+};
+
+// Replay stored blocks from position `first` on through three stages:
+//   reader   - walks the mapped block files and queues raw records,
+//   decoders - `workers` threads deserialize each block, compute its header
+//              hash and txids and check them against the index and the
+//              merkle root,
+//   applier  - the calling thread, which receives the blocks strictly in
+//              store order through `apply`.
+// At most a fixed window of blocks is in flight at any time. Stops at the
+// first block that fails to decode or verify, or when `apply` returns false.
+PipelineStats ReplayBlocks(const BlockStore& store, size_t first, int workers,
+                           const std::function<bool(DecodedBlock&)>& apply);
+
+} // namespace aurelis
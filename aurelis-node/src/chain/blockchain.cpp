@@ -1,18 +1,56 @@
 #include "chain/blockchain.hpp"
+#include "chain/block_pipeline.hpp"
 #include "chain/genesis.hpp"
+#include "util/mapped_file.hpp"
 #include "util/sha256.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <stdexcept>
 
 namespace aurelis {
 
-BlockChain::BlockChain() {
+BlockChain::BlockChain(const ChainOptions& opts)
+    : options(opts),
+      blockStore((std::filesystem::path(opts.dataDir) / "blocks").string(), opts.blockCacheBytes, opts.maxBlockFileSize,
+                 opts.fsyncPolicy, opts.fsyncIntervalMs),
+      coinsDB((std::filesystem::path(opts.dataDir) / "coins.dat").string()),
+      coins(coinsDB),
+      chainstateHeight(-1),
+      storeFailed(false),
+      validationPool(std::max(1, opts.validationThreads)),
+      publishedTip(std::make_shared<const ChainTip>()),
+      notifySequence(0),
+      deliveredSequence(0) {
+    if (opts.txIndex) {
+        txIndex.reset(new TxIndex((std::filesystem::path(opts.dataDir) / "txindex.dat").string()));
+    }
+    if (opts.addressHistory) {
+        addressHistory.reset(new AddressHistory((std::filesystem::path(opts.dataDir) / "addrhistory.dat").string()));
+    }
 }
 
-bool BlockChain::AddBlock(const Block& block) {
-    std::lock_guard<std::mutex> lock(chainMutex);
+bool BlockChain::AddBlock(std::shared_ptr<const Block> blockRef) {
+    if (!blockRef) return false;
+    const Block& block = *blockRef;
+
+    // The merkle check only reads the block, so it runs before readers are
+    // locked out
+    BlockConnected event;
+    if (!CheckBlockBody(block, event.spent)) return false;
+
+    std::unique_lock<SharedMutex> lock(chainMutex);
+    if (storeFailed) {
+        std::cout << "[CHAIN] Block REJECTED: block storage failed earlier, restart the node." << std::endl;
+        return false;
+    }
     
     uint256 hash = block.header.GetHash();
-    if (blockIndexMap.count(hash)) return false; // Already exists
+    if (chain.Contains(hash)) return false; // Already exists
 
     // Validate block (PoW check)
     if (!ValidateBlock(block)) {
@@ -20,152 +58,334 @@ bool BlockChain::AddBlock(const Block& block) {
     }
 
     // Check link to previous block (if not genesis)
-    if (!chain.empty()) {
-        if (block.header.prev_block != chain.back()->hash) {
-            std::cout << "[CHAIN] Block REJECTED: prev_block mismatch. Expected " << chain.back()->hash.ToString() << " got " << block.header.prev_block.ToString() << std::endl;
+    if (!chain.Empty()) {
+        if (block.header.prev_block != chain.Tip().hash) {
+            std::cout << "[CHAIN] Block REJECTED: prev_block mismatch. Expected " << chain.Tip().hash.ToString() << " got " << block.header.prev_block.ToString() << std::endl;
             return false;
         }
     }
 
-    auto index = std::make_shared<BlockIndex>(block, (int)chain.size());
-    chain.push_back(index);
-    blockIndexMap[hash] = index;
-    blockData[hash] = block;
+    if (!CheckInputs(block)) return false;
+
+    int height = chain.Push(block.header, hash);
+
+    ConnectUTXOs(block);
+    IndexBlock(block, height, -1, -1);
+    PublishTip();
 
-    // Update UTXO Set
+    std::cout << "[CHAIN] Accepted Block #" << height << " Hash: " << hash.ToString() << std::endl;
+    if (SaveBlock(blockRef)) MaybeWriteChainstate(height);
+    PruneBlockFiles();
+
+    if (blockConnectedHandlers.empty()) return true;
+    event.block = std::move(blockRef);
+    event.height = height;
+    event.hash = hash;
+    event.txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) event.txids.push_back(tx.GetHash()); // cached by CheckBlockBody
+    uint64_t sequence = ++notifySequence;
+    lock.unlock();
+    std::unique_lock<std::mutex> notify(notifyMutex);
+    notifyTurn.wait(notify, [&] { return deliveredSequence + 1 == sequence; });
+    for (const auto& handler : blockConnectedHandlers) handler(event);
+    deliveredSequence = sequence;
+    notifyTurn.notify_all();
+    return true;
+}
+
+void BlockChain::SubscribeBlockConnected(BlockConnectedHandler handler) {
+    blockConnectedHandlers.push_back(std::move(handler));
+}
+
+void BlockChain::ConnectUTXOs(const Block& block) {
     for (const auto& tx : block.vtx) {
         uint256 txid = tx.GetHash();
-        
+
         // Spend inputs
         for (const auto& in : tx.vin) {
             if (in.prevout_hash != uint256()) {
-                utxoSet.erase({in.prevout_hash, in.prevout_n});
+                SpendCoin({in.prevout_hash, in.prevout_n});
             }
         }
-        
+
         // Create new outputs
         for (uint32_t i = 0; i < tx.vout.size(); ++i) {
-            utxoSet[{txid, i}] = {tx.vout[i]};
+            AddCoin({txid, i}, tx.vout[i]);
         }
     }
+}
 
-    std::cout << "[CHAIN] Accepted Block #" << index->height << " Hash: " << hash.ToString() << std::endl;
-    SaveBlock(block);
-    return true;
+void BlockChain::IndexBlock(const Block& block, int height, int txIndexHeight, int historyHeight) {
+    if (txIndex && height > txIndexHeight) txIndex->AddBlock(block, height);
+    if (addressHistory && height > historyHeight) addressHistory->AddBlock(block, height);
+}
+
+void BlockChain::CatchUpIndexes(size_t to, int& txIndexHeight, int& historyHeight) {
+    size_t pruned = blockStore.PrunedCount();
+    size_t from = (size_t)(std::min(txIndexHeight, historyHeight) + 1);
+    if (from < pruned) {
+        std::cout << "[CHAIN] Indexes end at height " << from - 1 << " but blocks below " << pruned
+                  << " are pruned; that part of the history stays unindexed." << std::endl;
+        from = pruned;
+    }
+    if (from >= to) return;
+    size_t height = from;
+    ReplayBlocks(blockStore, height, options.loadThreads, [&](DecodedBlock& item) {
+        if (height >= to || item.hash != chain[height].hash) return false;
+        IndexBlock(item.block, (int)height++, txIndexHeight, historyHeight);
+        return true;
+    });
+    if (txIndex) txIndexHeight = txIndex->Height();
+    if (addressHistory) historyHeight = addressHistory->Height();
+}
+
+namespace {
+std::string ScriptKey(const std::vector<uint8_t>& script) {
+    return std::string((const char*)script.data(), script.size());
+}
+}
+
+void BlockChain::AddCoin(const OutPoint& op, const TxOut& out) {
+    // A repeated txid (identical coinbase) replaces the earlier coin
+    SpendCoin(op);
+    coins.Add(op, out);
+    AddressCoins& owner = addressIndex[ScriptKey(out.scriptPubKey)];
+    owner.balance += out.value;
+    owner.coins++;
+}
+
+void BlockChain::SpendCoin(const OutPoint& op) {
+    TxOut coin;
+    if (!coins.Get(op, coin)) return;
+    auto owner = addressIndex.find(ScriptKey(coin.scriptPubKey));
+    if (owner != addressIndex.end()) {
+        owner->second.balance -= coin.value;
+        if (--owner->second.coins == 0) addressIndex.erase(owner);
+    }
+    coins.Spend(op);
+}
+
+void BlockChain::RebuildAddressIndex() {
+    addressIndex.clear();
+    // Only valid right after a flush or open, when the cache is empty
+    coinsDB.ForEach([&](const OutPoint&, const CoinView& coin) {
+        AddressCoins& owner = addressIndex[std::string((const char*)coin.script, coin.scriptLen)];
+        owner.balance += coin.value;
+        owner.coins++;
+    });
 }
 
 int BlockChain::GetHeight() const {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    return (int)chain.size() - 1;
+    return std::atomic_load(&publishedTip)->height;
 }
 
 uint256 BlockChain::GetBestHash() const {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    if (chain.empty()) return uint256();
-    return chain.back()->hash;
+    return std::atomic_load(&publishedTip)->hash;
 }
 
-std::shared_ptr<BlockIndex> BlockChain::GetIndex(const uint256& hash) const {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    auto it = blockIndexMap.find(hash);
-    return (it != blockIndexMap.end()) ? it->second : nullptr;
+ChainTip BlockChain::GetTip() const {
+    return *std::atomic_load(&publishedTip);
+}
+
+void BlockChain::PublishTip() {
+    auto next = std::make_shared<ChainTip>();
+    if (!chain.Empty()) {
+        next->height = chain.Height();
+        next->hash = chain.Tip().hash;
+    }
+    std::atomic_store(&publishedTip, std::shared_ptr<const ChainTip>(std::move(next)));
+}
+
+bool BlockChain::GetIndex(const uint256& hash, BlockIndex& out) const {
+    std::shared_lock<SharedMutex> lock(chainMutex);
+    int height = chain.Find(hash);
+    if (height < 0) return false;
+    out = chain[height];
+    return true;
+}
+
+int BlockChain::GetBlockHeight(const uint256& hash) const {
+    std::shared_lock<SharedMutex> lock(chainMutex);
+    return chain.Find(hash);
 }
 
 bool BlockChain::ValidateBlock(const Block& block) {
     // 1. Proof of Work check
     uint256 hash = block.header.GetHash();
     if (hash.data[0] != 0 || hash.data[1] != 0) {
-        if (chain.empty()) return true; 
+        if (chain.Empty()) return true; 
         std::cout << "[CHAIN] Validation FAILED: Insufficient difficulty. Hash: " << hash.ToString() << std::endl;
         return false;
     }
+    return true;
+}
+
+namespace {
+// Transactions per work item on the validation pool
+const size_t TX_GRAIN = 64;
+}
 
-    // 2. Merkle Root check
+bool BlockChain::CheckBlockBody(const Block& block, std::vector<OutPoint>& spent) {
     if (block.vtx.empty()) {
         std::cout << "[CHAIN] Validation FAILED: No transactions." << std::endl;
         return false;
     }
-    
-    uint256 computedMerkle;
-    if (block.vtx.size() == 1) {
-        computedMerkle = block.vtx[0].GetHash();
-    } else {
-        Serializer mer;
-        for (const auto& tx : block.vtx) {
-            uint256 h = tx.GetHash();
-            mer.write(h.data.data(), h.data.size());
-        }
-        Hash256(mer.buffer.data(), mer.buffer.size(), computedMerkle.data.data());
-    }
+
+    // Hash every txid in parallel; the merkle root and the UTXO updates then
+    // read the cached values
+    validationPool.ParallelFor(block.vtx.size(), TX_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) block.vtx[i].GetHash();
+    });
+    uint256 computedMerkle = ComputeMerkleRoot(block.vtx);
 
     if (block.header.merkle_root != computedMerkle) {
         std::cout << "[CHAIN] Validation FAILED: Merkle root mismatch. Header: " << block.header.merkle_root.ToString() << " Computed: " << computedMerkle.ToString() << std::endl;
         return false;
     }
 
+    spent.clear();
+    for (const auto& tx : block.vtx) {
+        for (const auto& in : tx.vin) {
+            if (in.prevout_hash != uint256()) spent.push_back({in.prevout_hash, in.prevout_n});
+        }
+    }
+    std::sort(spent.begin(), spent.end());
+    auto dup = std::adjacent_find(spent.begin(), spent.end());
+    if (dup != spent.end()) {
+        std::cout << "[CHAIN] Validation FAILED: Output " << dup->hash.ToString() << ":" << dup->n << " spent twice in block." << std::endl;
+        return false;
+    }
+
     return true;
 }
 
-int64_t BlockChain::GetBalance(const std::string& address) const {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    int64_t balance = 0;
-    for (const auto& pair : utxoSet) {
-        const UTXO& utxo = pair.second;
-        std::string scriptAddr;
-        if (!utxo.out.scriptPubKey.empty()) {
-             scriptAddr = std::string((const char*)utxo.out.scriptPubKey.data(), utxo.out.scriptPubKey.size());
-        }
-        if (scriptAddr == address) {
-            balance += utxo.out.value;
+bool BlockChain::CheckInputs(const Block& block) {
+    // Outputs created inside the block, by txid -> first transaction
+    std::unordered_map<uint256, size_t, Uint256Hasher> created;
+    created.reserve(block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); ++i) created.emplace(block.vtx[i].GetHash(), i);
+
+    // Index of the first transaction with a missing input
+    std::atomic<size_t> firstBad(SIZE_MAX);
+    validationPool.ParallelFor(block.vtx.size(), TX_GRAIN, [&](size_t begin, size_t end) {
+        TxOut coin;
+        for (size_t i = begin; i < end && i < firstBad.load(std::memory_order_relaxed); ++i) {
+            for (const auto& in : block.vtx[i].vin) {
+                if (in.prevout_hash == uint256()) continue;
+                auto it = created.find(in.prevout_hash);
+                if (it != created.end() && it->second < i && in.prevout_n < block.vtx[it->second].vout.size()) continue;
+                if (coins.Get({in.prevout_hash, in.prevout_n}, coin)) continue;
+                size_t bad = firstBad.load(std::memory_order_relaxed);
+                while (i < bad && !firstBad.compare_exchange_weak(bad, i)) {}
+                break;
+            }
         }
+    });
+    if (firstBad != SIZE_MAX) {
+        std::cout << "[CHAIN] Validation FAILED: Transaction " << block.vtx[firstBad].GetHash().ToString()
+                  << " spends a missing or already spent output." << std::endl;
+        return false;
     }
-    return balance;
+    return true;
+}
+
+int64_t BlockChain::GetBalance(const std::string& address) const {
+    std::shared_lock<SharedMutex> lock(chainMutex);
+    auto it = addressIndex.find(address);
+    return it != addressIndex.end() ? it->second.balance : 0;
+}
+
+bool BlockChain::GetCoin(const OutPoint& op, TxOut& out) const {
+    std::shared_lock<SharedMutex> lock(chainMutex);
+    return coins.Get(op, out);
 }
 
 std::vector<std::pair<OutPoint, UTXO>> BlockChain::GetUTXOs(const std::string& address) const {
-    std::lock_guard<std::mutex> lock(chainMutex);
+    std::shared_lock<SharedMutex> lock(chainMutex);
     std::vector<std::pair<OutPoint, UTXO>> results;
-    for (const auto& pair : utxoSet) {
-        const UTXO& utxo = pair.second;
-        std::string scriptAddr;
-        if (!utxo.out.scriptPubKey.empty()) {
-            scriptAddr = std::string((const char*)utxo.out.scriptPubKey.data(), utxo.out.scriptPubKey.size());
-        }
-        if (scriptAddr == address) {
-            results.push_back(pair);
-        }
+    auto it = addressIndex.find(address);
+    if (it == addressIndex.end()) return results;
+    results.reserve(it->second.coins);
+    bool ok = coins.ForEachWithScript(address, [&](const OutPoint& op, const CoinView& coin) {
+        UTXO utxo;
+        utxo.out = coin.ToTxOut();
+        results.push_back({op, std::move(utxo)});
+    });
+    if (!ok) {
+        std::cout << "[CHAIN] Cannot read the coins of an address back from coins.dat" << std::endl;
+        return {};
     }
+    std::sort(results.begin(), results.end(),
+              [](const std::pair<OutPoint, UTXO>& a, const std::pair<OutPoint, UTXO>& b) { return a.first < b.first; });
+    // A coin created twice since the last flush is listed twice
+    results.erase(std::unique(results.begin(), results.end(),
+                              [](const std::pair<OutPoint, UTXO>& a, const std::pair<OutPoint, UTXO>& b) { return a.first == b.first; }),
+                  results.end());
     return results;
 }
 
-Block BlockChain::GetBlockByHeight(int height) const {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    if (height < 0 || height >= (int)chain.size()) return Block();
-    auto it = blockData.find(chain[height]->hash);
-    if (it == blockData.end()) return Block();
-    return it->second;
+std::shared_ptr<const Block> BlockChain::GetBlockByHeight(int height) const {
+    uint256 hash;
+    {
+        std::shared_lock<SharedMutex> lock(chainMutex);
+        if (height < 0 || height >= (int)chain.Size()) return nullptr;
+        hash = chain[height].hash;
+    }
+    return blockStore.ReadBlock(hash);
+}
+
+uint256 BlockChain::GetBlockHash(int height) const {
+    std::shared_lock<SharedMutex> lock(chainMutex);
+    if (height < 0 || height >= (int)chain.Size()) return uint256();
+    return chain[height].hash;
 }
 
-Block BlockChain::GetBlock(const uint256& hash) const {
-    std::lock_guard<std::mutex> lock(chainMutex);
-    auto it = blockData.find(hash);
-    if (it != blockData.end()) return it->second;
-    return Block();
+bool BlockChain::IsBlockPruned(const uint256& hash) const {
+    return blockStore.IsPruned(hash);
 }
 
-bool BlockChain::GetTransaction(const uint256& hash, Transaction& outTx, uint256& outBlockHash) const {
-    std::lock_guard<std::mutex> lock(chainMutex);
+std::vector<TxLocation> BlockChain::GetAddressHistory(const std::string& address, uint64_t cursor, size_t count, uint64_t& next) const {
+    next = 0;
+    if (!addressHistory) return {};
+    std::shared_lock<SharedMutex> lock(chainMutex);
+    return addressHistory->GetPage(address, cursor, count, next);
+}
+
+std::shared_ptr<const Block> BlockChain::GetBlock(const uint256& hash) const {
+    // The block store has its own lock
+    return blockStore.ReadBlock(hash);
+}
+
+bool BlockChain::GetTransaction(const uint256& hash, std::shared_ptr<const Block>& outBlock, size_t& outPos) const {
+    if (txIndex) {
+        uint256 blockHash;
+        uint32_t pos;
+        {
+            std::shared_lock<SharedMutex> lock(chainMutex);
+            TxLocation loc;
+            if (!txIndex->Find(hash, loc) || loc.height >= (int)chain.Size()) return false;
+            blockHash = chain[loc.height].hash;
+            pos = loc.index;
+        }
+        // The block read does not need the chain lock
+        auto block = blockStore.ReadBlock(blockHash);
+        // A location is only trusted if it still holds the transaction
+        if (!block || pos >= block->vtx.size() || block->vtx[pos].GetHash() != hash) return false;
+        outBlock = std::move(block);
+        outPos = pos;
+        return true;
+    }
+
+    std::shared_lock<SharedMutex> lock(chainMutex);
     // Reverse search (newest first)
-    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
-        auto blockIt = blockData.find((*it)->hash);
-        if (blockIt != blockData.end()) {
-            const Block& block = blockIt->second;
-            for (const auto& tx : block.vtx) {
-                if (tx.GetHash() == hash) {
-                    outTx = tx;
-                    outBlockHash = block.header.GetHash();
-                    return true;
-                }
+    for (int height = chain.Height(); height >= 0; --height) {
+        auto block = blockStore.ReadBlock(chain[height].hash);
+        if (!block) continue;
+        for (size_t i = 0; i < block->vtx.size(); ++i) {
+            if (block->vtx[i].GetHash() == hash) {
+                outBlock = std::move(block);
+                outPos = i;
+                return true;
             }
         }
     }
@@ -173,65 +393,205 @@ bool BlockChain::GetTransaction(const uint256& hash, Transaction& outTx, uint256
 }
 
 // --- Persistence Layer ---
-void BlockChain::SaveBlock(const Block& block) {
-    // Simple append-only storage
-    std::ofstream file("blockchain.dat", std::ios::binary | std::ios::app);
-    if (file.is_open()) {
-        Serializer s;
-        s << block;
-        file.write((const char*)s.buffer.data(), s.buffer.size());
-        file.close();
+bool BlockChain::SaveBlock(std::shared_ptr<const Block> block) {
+    uint256 hash = block->header.GetHash();
+    if (blockStore.WriteBlock(std::move(block), hash)) return true;
+    // Writes are queued, so the failure may belong to an earlier block
+    std::cout << "[CHAIN] Block store write failed (at or before block " << hash.ToString() << "); no further blocks will be connected." << std::endl;
+    storeFailed = true;
+    return false;
+}
+
+void BlockChain::ImportLegacyFile(const std::string& path) {
+    MappedFile file;
+    if (!file.Open(path) || file.size() == 0) return;
+
+    Deserializer d(file.data(), file.size());
+    int count = 0;
+    try {
+        while (d.remaining() > 0) {
+            auto block = std::make_shared<Block>();
+            d >> *block;
+            if (!blockStore.WriteBlock(block, block->header.GetHash())) break;
+            count++;
+        }
+    } catch (...) {
+        std::cout << "[CHAIN] Warning: Corrupt blockchain data found. Imported " << count << " blocks." << std::endl;
+    }
+    std::cout << "[CHAIN] Imported " << count << " blocks from legacy " << path << std::endl;
+}
+
+// --- Chainstate (coin database commits) ---
+
+bool BlockChain::WriteChainstate(int height) {
+    if (height < 0 || height >= (int)chain.Size()) return false;
+    // The coin database must never reference blocks that are not yet durable
+    if (storeFailed || !blockStore.Flush()) {
+        if (!storeFailed) std::cout << "[CHAIN] Block storage failed; coin database left at height " << chainstateHeight << std::endl;
+        storeFailed = true;
+        return false;
+    }
+    if (!coins.Flush(chain[height].hash, height)) {
+        std::cout << "[CHAIN] Coin database flush failed at height " << height << std::endl;
+        return false;
     }
+    chainstateHeight = height;
+    return true;
+}
+
+void BlockChain::MaybeWriteChainstate(int height) {
+    bool overBudget = coins.MemoryUsage() > options.coinCacheBytes;
+    bool stale = options.chainstateInterval > 0 && height - chainstateHeight >= options.chainstateInterval;
+    if (overBudget || stale) WriteChainstate(height);
+}
+
+namespace {
+// Always keep this many recent blocks on disk, whatever the prune target
+const int MIN_BLOCKS_TO_KEEP = 288;
+}
+
+void BlockChain::PruneBlockFiles() {
+    if (options.pruneTargetBytes == 0 || chain.Empty()) return;
+    if (blockStore.DiskUsage() <= options.pruneTargetBytes) return;
+
+    // Blocks after the last coin commit are replayed after a crash, so
+    // commit first to make everything but the recent window prunable
+    int tip = chain.Height();
+    if (chainstateHeight < tip) WriteChainstate(tip);
+    int keepFrom = std::max(0, std::min(chainstateHeight + 1, tip + 1 - MIN_BLOCKS_TO_KEEP));
+    int removed = blockStore.Prune(options.pruneTargetBytes, (size_t)keepFrom);
+    if (removed > 0) {
+        std::cout << "[CHAIN] Pruned " << removed << " block file(s); block data below height "
+                  << blockStore.PrunedCount() << " is no longer stored." << std::endl;
+    }
+}
+
+void BlockChain::FlushChainstate() {
+    std::unique_lock<SharedMutex> lock(chainMutex);
+    if (!chain.Empty() && chain.Height() != chainstateHeight) {
+        WriteChainstate(chain.Height());
+    } else {
+        blockStore.Flush();
+    }
+}
+
+namespace {
+void LogReplayStats(const PipelineStats& stats) {
+    auto rate = [](double n, double seconds) { return seconds > 0 ? n / seconds : 0.0; };
+    double mb = stats.bytes / (1024.0 * 1024.0);
+    std::cout << std::fixed << std::setprecision(2)
+              << "[REINDEX] " << stats.blocks << " blocks, " << stats.txs << " txs, " << mb << " MB in "
+              << stats.wallSeconds << "s using " << stats.workers << " decode threads" << std::endl
+              << "[REINDEX]   read:   " << stats.readSeconds << "s busy, " << rate(mb, stats.readSeconds) << " MB/s" << std::endl
+              << "[REINDEX]   decode: " << stats.decodeSeconds << "s busy (all threads), "
+              << rate(stats.blocks, stats.decodeSeconds / stats.workers) << " blocks/s" << std::endl
+              << "[REINDEX]   apply:  " << stats.applySeconds << "s busy, " << rate(stats.txs, stats.applySeconds) << " txs/s" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
 }
+} // namespace
 
 void BlockChain::LoadChain() {
-    std::ifstream file("blockchain.dat", std::ios::binary);
-    if (!file.is_open()) return;
+    std::unique_lock<SharedMutex> lock(chainMutex);
+    if (!blockStore.Open()) return;
+    // Starting without the coins would rebuild nothing and commit over them;
+    // -reindex rebuilds them anyway, so it may start from an empty file
+    if (!coinsDB.Open() && !(options.reindex && coinsDB.Wipe())) {
+        throw std::runtime_error("cannot open the coin database in " + options.dataDir + "; start with -reindex to rebuild it");
+    }
 
-    // Read entire file into buffer (simple for prototype)
-    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();
+    // One-time migration from the single-file format
+    std::string legacyPath = (std::filesystem::path(options.dataDir) / "blockchain.dat").string();
+    if (blockStore.Size() == 0) {
+        ImportLegacyFile(legacyPath);
+    }
 
-    if (buffer.empty()) return;
+    chain.Reserve(blockStore.Size());
 
-    Deserializer d(buffer);
-    int count = 0;
-    try {
-        while (d.pos < d.buffer.size()) {
-            Block block;
-            d >> block;
-            
-            // Bypass Proof-of-Work check for faster loading, but verify links
-            // (In a real system we'd check everything, but efficiently)
-            // Here we just re-add it to internal structures manually to bypass "New Block" logic
-            
-            uint256 hash = block.header.GetHash();
-            // Fix: Check size BEFORE accessing index 0 to avoid segfault
-            if (chain.size() > 0 && hash == chain[0]->hash) continue; // Skip genesis if already there
-
-            auto index = std::make_shared<BlockIndex>(block, (int)chain.size());
-            chain.push_back(index);
-            blockIndexMap[hash] = index;
-            blockData[hash] = block;
-
-            // Rebuild UTXO set
-            for (const auto& tx : block.vtx) {
-                uint256 txid = tx.GetHash();
-                for (const auto& in : tx.vin) {
-                    if (in.prevout_hash != uint256()) {
-                        utxoSet.erase({in.prevout_hash, in.prevout_n});
-                    }
-                }
-                for (uint32_t i = 0; i < tx.vout.size(); ++i) {
-                    utxoSet[{txid, i}] = {tx.vout[i]};
-                }
-            }
+    // Rebuild the block index from headers only; the stored index supplies
+    // the hashes, so nothing is rehashed here.
+    // Bypass Proof-of-Work check for faster loading, but verify links
+    blockStore.ForEachHeader([&](const uint256& hash, const BlockHeader& header) {
+        if (!chain.Empty() && header.prev_block != chain.Tip().hash) {
+            std::cout << "[CHAIN] Stored block " << hash.ToString() << " does not extend the chain, stopping load" << std::endl;
+            return false;
+        }
+        chain.Push(header, hash);
+        return true;
+    });
+
+    // Resume from the coin database if its best block is on this chain and
+    // only replay the blocks after it
+    size_t replayFrom = 0;
+    int coinsHeight = coinsDB.Height();
+    bool coinsMatch = coinsHeight >= 0 && coinsHeight < (int)chain.Size() && chain[coinsHeight].hash == coinsDB.BestBlock();
+    size_t pruned = blockStore.PrunedCount();
+    if (pruned > 0 && (options.reindex || !coinsMatch)) {
+        throw std::runtime_error("block data below height " + std::to_string(pruned) +
+                                 " has been pruned, so the chainstate cannot be rebuilt; start again with an empty data directory");
+    }
+    if (options.reindex) {
+        std::cout << "[CHAIN] Reindex requested: rebuilding chainstate from all stored blocks." << std::endl;
+        coinsDB.Wipe();
+    } else if (coinsMatch) {
+        replayFrom = (size_t)coinsHeight + 1;
+        chainstateHeight = coinsHeight;
+        std::cout << "[CHAIN] Loaded chainstate at height " << coinsHeight << " (" << coinsDB.Size() << " coins)." << std::endl;
+    } else if (coinsHeight >= 0) {
+        std::cout << "[CHAIN] Coin database does not match the stored chain, rebuilding it." << std::endl;
+        coinsDB.Wipe();
+    }
+    RebuildAddressIndex();
+
+    // Indexes may lag behind the snapshot: catch up on those blocks without
+    // connecting them again
+    int tip = options.reindex ? -1 : (int)chain.Size() - 1;
+    int txIndexHeight = txIndex ? txIndex->Open(tip) : (int)chain.Size() - 1;
+    int historyHeight = addressHistory ? addressHistory->Open(tip) : (int)chain.Size() - 1;
+    CatchUpIndexes(replayFrom, txIndexHeight, historyHeight);
+
+    // Decoding and txid hashing run on worker threads; UTXO updates are
+    // applied here in chain order
+    size_t count = 0;
+    if (replayFrom < chain.Size()) {
+        PipelineStats stats = ReplayBlocks(blockStore, replayFrom, options.loadThreads, [&](DecodedBlock& item) {
+            size_t height = replayFrom + count;
+            if (height >= chain.Size() || item.hash != chain[height].hash) return false;
+            ConnectUTXOs(item.block);
+            IndexBlock(item.block, (int)height, txIndexHeight, historyHeight);
             count++;
+            // Only the memory budget forces a flush here; the tail is
+            // committed once at the end
+            if (coins.MemoryUsage() > options.coinCacheBytes) WriteChainstate((int)height);
+            return true;
+        });
+        if (options.reindex) LogReplayStats(stats);
+    }
+    if (replayFrom + count < chain.Size()) {
+        std::cout << "[CHAIN] Only " << replayFrom + count << " of " << chain.Size() << " blocks could be connected." << std::endl;
+        chain.Truncate(replayFrom + count);
+        // The indexes were opened against the longer chain. Rewind them,
+        // or the blocks later connected at those heights are skipped and
+        // lookups follow entries into the wrong blocks.
+        int newTip = (int)chain.Size() - 1;
+        if (txIndex && txIndex->Height() > newTip) txIndexHeight = txIndex->Open(newTip);
+        if (addressHistory && addressHistory->Height() > newTip) historyHeight = addressHistory->Open(newTip);
+        CatchUpIndexes(chain.Size(), txIndexHeight, historyHeight);
+    }
+    // Blocks past the loaded tip (not extending it, or not connectable)
+    // must go: new blocks are appended after them, and the next load
+    // would stop at the first stale one and lose everything after it
+    if (blockStore.Size() > chain.Size()) {
+        std::cout << "[CHAIN] Dropping " << blockStore.Size() - chain.Size() << " stored blocks past the loaded tip." << std::endl;
+        if (!blockStore.Truncate(chain.Size())) {
+            throw std::runtime_error("cannot drop stale blocks from the block store in " + options.dataDir);
         }
-    } catch (...) {
-        std::cout << "[CHAIN] Warning: Corrupt blockchain data found. Loaded " << count << " blocks." << std::endl;
     }
-    std::cout << "[CHAIN] Loaded " << count << " blocks from disk." << std::endl;
+    PublishTip();
+    std::cout << "[CHAIN] Loaded " << chain.Size() << " blocks from disk (" << count << " replayed)." << std::endl;
+    if (txIndex) std::cout << "[CHAIN] Transaction index covers " << txIndex->Size() << " transactions." << std::endl;
+
+    if ((int)chain.Size() - 1 != chainstateHeight) WriteChainstate((int)chain.Size() - 1);
+    PruneBlockFiles();
 }
 
 } // namespace aurelis
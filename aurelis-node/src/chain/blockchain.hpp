@@ -1,71 +1,190 @@
 #pragma once
 
 #include "chain/block.hpp"
+#include "chain/address_history.hpp"
+#include "chain/blockstore.hpp"
+#include "chain/chain_index.hpp"
+#include "chain/coins_cache.hpp"
+#include "chain/coins_db.hpp"
+#include "chain/txindex.hpp"
+#include "util/shared_mutex.hpp"
+#include "util/worker_pool.hpp"
+#include <condition_variable>
+#include <functional>
 #include <vector>
-#include <map>
+#include <unordered_map>
 #include <memory>
 #include <mutex>
-#include <fstream>
+#include <string>
 
 namespace aurelis {
 
 
-struct BlockIndex {
+struct UTXO {
+    TxOut out;
+};
+
+// Height and hash of the chain tip, published as one immutable value so
+// readers never wait for the chain lock
+struct ChainTip {
+    int height = -1;
     uint256 hash;
-    BlockHeader header;
-    int height;
-    
-    BlockIndex(const Block& block, int h) : header(block.header), height(h) {
-        hash = header.GetHash();
-    }
 };
 
-struct OutPoint {
+// Published after a block is connected. The txids and spent outpoints were
+// computed during validation, so subscribers need not hash the block again.
+struct BlockConnected {
+    std::shared_ptr<const Block> block;
+    int height = -1;
     uint256 hash;
-    uint32_t n;
-    bool operator<(const OutPoint& other) const {
-        if (hash != other.hash) return hash.data < other.hash.data;
-        return n < other.n;
-    }
+    std::vector<uint256> txids;    // in block order
+    std::vector<OutPoint> spent;   // every input's prevout, sorted
 };
 
-struct UTXO {
-    TxOut out;
+using BlockConnectedHandler = std::function<void(const BlockConnected&)>;
+
+struct ChainOptions {
+    std::string dataDir = ".";
+    size_t blockCacheBytes = 32 * 1024 * 1024;   // -blockcache (MB)
+    size_t coinCacheBytes = 128 * 1024 * 1024;   // -dbcache (MB): pending coin changes before a flush
+    uint32_t maxBlockFileSize = 128 * 1024 * 1024;
+    FsyncPolicy fsyncPolicy = FsyncPolicy::Interval; // -fsync=always|never|<ms>
+    int fsyncIntervalMs = 1000;
+    int chainstateInterval = 100;                 // max blocks between coin database flushes
+    bool reindex = false;                         // -reindex: wipe the coin database, replay every block
+    int loadThreads = 1;                          // decode workers used when replaying blocks
+    int validationThreads = 1;                    // -par: threads checking a new block's transactions
+    bool txIndex = false;                         // -txindex: maintain txid -> block position
+    bool addressHistory = false;                  // -addresshistory: maintain address -> transactions
+    uint64_t pruneTargetBytes = 0;                // -prune (MB): block file budget, 0 keeps every block
 };
 
 class BlockChain {
 public:
-    BlockChain();
+    explicit BlockChain(const ChainOptions& options = ChainOptions());
     
     // Persistence
     void LoadChain();
-    void SaveBlock(const Block& block);
+    // False (and logged) if the block store reports a failed write
+    bool SaveBlock(std::shared_ptr<const Block> block);
+    // Sync queued blocks and flush the coin cache now (clean shutdown).
+    void FlushChainstate();
 
-    bool AddBlock(const Block& block);
+    // The block is kept as is (no copy) by the block store once accepted
+    bool AddBlock(std::shared_ptr<const Block> block);
+    // Called once per connected block, in chain order, after the chain lock
+    // is released (handlers may query the chain). Subscribe before blocks
+    // arrive from other threads.
+    void SubscribeBlockConnected(BlockConnectedHandler handler);
     int GetHeight() const;
     uint256 GetBestHash() const;
+    // Consistent height + hash pair; lock-free
+    ChainTip GetTip() const;
     
     // Explorer / Data Retrieval
-    Block GetBlock(const uint256& hash) const;
-    bool GetTransaction(const uint256& hash, Transaction& outTx, uint256& outBlockHash) const;
-    std::shared_ptr<BlockIndex> GetIndex(const uint256& hash) const;
-    Block GetBlockByHeight(int height) const;
+    // Blocks are shared and immutable; handing one out costs a refcount.
+    // nullptr if unknown or pruned.
+    std::shared_ptr<const Block> GetBlock(const uint256& hash) const;
+    // The block holding `hash` and the transaction's position in it
+    bool GetTransaction(const uint256& hash, std::shared_ptr<const Block>& outBlock, size_t& outPos) const;
+    // Copy of the index entry for `hash`; false if it is not on the chain
+    bool GetIndex(const uint256& hash, BlockIndex& out) const;
+    int GetBlockHeight(const uint256& hash) const; // -1 if not on the chain
+    std::shared_ptr<const Block> GetBlockByHeight(int height) const; // nullptr if out of range
+    uint256 GetBlockHash(int height) const; // null if out of range
+    // True if the block is known but its data was deleted by pruning
+    bool IsBlockPruned(const uint256& hash) const;
+    // Newest-first page of the address's history; see AddressHistory::GetPage.
+    // Always empty unless HasAddressHistory().
+    bool HasAddressHistory() const { return addressHistory != nullptr; }
+    std::vector<TxLocation> GetAddressHistory(const std::string& address, uint64_t cursor, size_t count, uint64_t& next) const;
     
     // UTXO Management (Simplified for prototype)
     int64_t GetBalance(const std::string& address) const;
+    // Unspent output at `op` in the current UTXO set
+    bool GetCoin(const OutPoint& op, TxOut& out) const;
+    // Coins paying `address`, by outpoint; costs one read per coin written
+    // for it since the coin database was last compacted
     std::vector<std::pair<OutPoint, UTXO>> GetUTXOs(const std::string& address) const;
 
 private:
-    std::vector<std::shared_ptr<BlockIndex>> chain;
-    std::map<uint256, std::shared_ptr<BlockIndex>> blockIndexMap;
-    std::map<uint256, Block> blockData;
+    ChainIndex chain;
+    ChainOptions options;
+    BlockStore blockStore;
     
-    // UTXO Set
-    std::map<OutPoint, UTXO> utxoSet;
+    // UTXO set: on disk in <dataDir>/coins.dat behind a write-back cache
+    CoinsDB coinsDB;
+    CoinsCache coins;
+
+    // scriptPubKey -> how many coins it owns and their running total, kept
+    // in step with the UTXO set so balance queries never scan it. Which
+    // coins those are is found through the coin database's per-script
+    // chains: memory grows with addresses, not with the UTXO set.
+    struct AddressCoins {
+        int64_t balance = 0;
+        size_t coins = 0;
+    };
+    std::unordered_map<std::string, AddressCoins> addressIndex;
+
+    std::unique_ptr<TxIndex> txIndex; // null unless options.txIndex
+    std::unique_ptr<AddressHistory> addressHistory; // null unless options.addressHistory
     
-    mutable std::mutex chainMutex;
+    int chainstateHeight; // height of the last coin database commit
+    // A block write failed: the coins may be ahead of the block files, so
+    // no further block is connected and the coin database is not committed
+    bool storeFailed;
+
+    WorkerPool validationPool;
+
+    // Shared by readers, exclusive while a block is connected or the chain
+    // is loaded; a waiting writer goes ahead of new readers
+    mutable SharedMutex chainMutex;
+    // Replaced under the exclusive lock, read with std::atomic_load
+    std::shared_ptr<const ChainTip> publishedTip;
 
+    std::vector<BlockConnectedHandler> blockConnectedHandlers;
+    // Events are numbered under chainMutex and delivered in that order once
+    // the chain lock is released; a handler may wait on the chain while a
+    // later block connects
+    uint64_t notifySequence;       // last event numbered, under chainMutex
+    uint64_t deliveredSequence;    // last event delivered, under notifyMutex
+    std::mutex notifyMutex;
+    std::condition_variable notifyTurn;
+
+    // Snapshot the current tip into `publishedTip`. Callers hold chainMutex
+    // exclusively.
+    void PublishTip();
+
+    // Context-free checks, run before chainMutex is taken: the block has
+    // transactions, its merkle root matches (txids hashed on
+    // validationPool) and no outpoint is spent twice within it. Fills
+    // `spent` with the block's input prevouts, sorted.
+    bool CheckBlockBody(const Block& block, std::vector<OutPoint>& spent);
+    // Proof-of-work check against the current chain. Callers hold
+    // chainMutex.
     bool ValidateBlock(const Block& block);
+    // Every input spends a coin in the UTXO set or an output of an earlier
+    // transaction in the block; looked up on validationPool. Callers hold
+    // chainMutex exclusively.
+    bool CheckInputs(const Block& block);
+    void ConnectUTXOs(const Block& block);
+    void AddCoin(const OutPoint& op, const TxOut& out);
+    void SpendCoin(const OutPoint& op);
+    void RebuildAddressIndex();
+    // Feed a connected block to the indexes that have not seen it yet
+    void IndexBlock(const Block& block, int height, int txIndexHeight, int historyHeight);
+    // Index the stored, already connected blocks below `to` that the
+    // indexes have not seen, then update both heights
+    void CatchUpIndexes(size_t to, int& txIndexHeight, int& historyHeight);
+    void ImportLegacyFile(const std::string& path);
+
+    // Commit the coin cache as the state at chain[height]. Callers hold
+    // chainMutex exclusively.
+    bool WriteChainstate(int height);
+    // Flush if the cache is over budget or the last commit is too old
+    void MaybeWriteChainstate(int height);
+    // Delete old block files once they exceed options.pruneTargetBytes
+    void PruneBlockFiles();
 };
 
 } // namespace aurelis
@@ -0,0 +1,709 @@
+#include "chain/blockstore.hpp"
+#include "util/mapped_file.hpp"
+#include "util/serialize.hpp"
+#include "util/sha256.hpp"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace aurelis {
+
+namespace {
+
+const uint32_t BLOCK_FILE_MAGIC = 0x4155524C; // "AURL"
+const size_t FRAME_HEADER_SIZE = 12;          // magic + length + checksum
+const size_t INDEX_RECORD_SIZE = 32 + 4 + 4 + 4;
+const size_t HEADER_RECORD_SIZE = 80;          // serialized BlockHeader
+
+// Rough heap footprint of a deserialized block, used to charge the cache.
+size_t EstimateBlockMemory(const Block& block) {
+    size_t bytes = sizeof(Block) + block.vtx.capacity() * sizeof(Transaction);
+    for (const auto& tx : block.vtx) {
+        bytes += tx.vin.capacity() * sizeof(TxIn) + tx.vout.capacity() * sizeof(TxOut);
+        for (const auto& in : tx.vin) bytes += in.scriptSig.capacity();
+        for (const auto& out : tx.vout) bytes += out.scriptPubKey.capacity();
+    }
+    return bytes;
+}
+
+uint32_t FrameChecksum(const uint8_t* data, size_t len) {
+    uint8_t hash[32];
+    Hash256(data, len, hash);
+    return (uint32_t)hash[0] | ((uint32_t)hash[1] << 8) | ((uint32_t)hash[2] << 16) | ((uint32_t)hash[3] << 24);
+}
+
+void PutLE32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (uint8_t)(v >> (i * 8));
+}
+
+uint32_t GetLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Read the frame at `frameStart` into `data`, verifying magic, length
+// (`expectedLength`, unless 0) and checksum. False for anything torn.
+bool ReadFrame(FILE* f, uint64_t frameStart, uint32_t expectedLength, std::vector<uint8_t>& data) {
+    uint8_t header[FRAME_HEADER_SIZE];
+    if (fseek(f, (long)frameStart, SEEK_SET) != 0 || fread(header, 1, sizeof(header), f) != sizeof(header)) return false;
+    uint32_t length = GetLE32(header + 4);
+    if (GetLE32(header) != BLOCK_FILE_MAGIC || (expectedLength && length != expectedLength)) return false;
+    data.resize(length);
+    if (fread(data.data(), 1, length, f) != length) return false;
+    return FrameChecksum(data.data(), length) == GetLE32(header + 8);
+}
+
+} // namespace
+
+BlockStore::BlockStore(const std::string& d, size_t cache, uint32_t maxFile, FsyncPolicy policy, int syncMs)
+    : dir(d), cacheBytes(cache), maxFileSize(maxFile), syncPolicy(policy), syncIntervalMs(syncMs),
+      currentFile(0), currentSize(0), prunedFiles(0), prunedEntries(0), diskBytes(0), cacheUsed(0),
+      queuedSeq(0), writtenSeq(0), syncedSeq(0), syncRequested(false), stopWriter(false), writeError(false),
+      blockFile(nullptr), blockFileNum(0), indexFile(nullptr), headerFile(nullptr) {}
+
+BlockStore::~BlockStore() {
+    {
+        std::lock_guard<std::mutex> lock(storeMutex);
+        stopWriter = true;
+    }
+    writerWake.notify_all();
+    if (writerThread.joinable()) writerThread.join();
+    if (blockFile) fclose(blockFile);
+    if (indexFile) fclose(indexFile);
+    if (headerFile) fclose(headerFile);
+}
+
+std::string BlockStore::BlockFilePath(uint32_t file) const {
+    char name[32];
+    snprintf(name, sizeof(name), "blk%05u.dat", file);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+std::string BlockStore::IndexPath() const {
+    return (std::filesystem::path(dir) / "index.dat").string();
+}
+
+std::string BlockStore::HeadersPath() const {
+    return (std::filesystem::path(dir) / "headers.dat").string();
+}
+
+bool BlockStore::Open() {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    if (writerThread.joinable()) return true;
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        std::cout << "[STORE] Cannot create block directory " << dir << ": " << ec.message() << std::endl;
+        return false;
+    }
+
+    entries.clear();
+    entryIndex.clear();
+
+    bool rewriteIndex = false;
+    FILE* f = fopen(IndexPath().c_str(), "rb");
+    if (f) {
+        std::vector<uint8_t> record(INDEX_RECORD_SIZE);
+        size_t got;
+        while ((got = fread(record.data(), 1, record.size(), f)) == record.size()) {
+            Deserializer d(record);
+            Entry e;
+            d.read(e.hash.data.data(), e.hash.data.size());
+            d >> e.pos.file >> e.pos.offset >> e.pos.length;
+            if (entryIndex.count(e.hash)) continue;
+            entryIndex[e.hash] = entries.size();
+            entries.push_back(e);
+        }
+        // A torn trailing record (crash mid-append) is dropped
+        rewriteIndex = got != 0;
+        fclose(f);
+    }
+
+    if (RecoverTail()) rewriteIndex = true;
+
+    if (rewriteIndex) {
+        Serializer s;
+        for (const auto& e : entries) {
+            s.write(e.hash.data.data(), e.hash.data.size());
+            s << e.pos.file << e.pos.offset << e.pos.length;
+        }
+        std::string tmpPath = IndexPath() + ".tmp";
+        FILE* out = fopen(tmpPath.c_str(), "wb");
+        bool ok = out && fwrite(s.buffer.data(), 1, s.buffer.size(), out) == s.buffer.size() && SyncFile(out);
+        if (out) ok = (fclose(out) == 0) && ok;
+        if (ok) std::filesystem::rename(tmpPath, IndexPath(), ec);
+        if (!ok || ec) {
+            std::cout << "[STORE] Cannot rewrite " << IndexPath() << std::endl;
+            return false;
+        }
+    }
+
+    // Files below the first one still present were pruned
+    prunedFiles = 0;
+    while (prunedFiles < currentFile && !std::filesystem::exists(BlockFilePath(prunedFiles), ec)) prunedFiles++;
+    prunedEntries = 0;
+    while (prunedEntries < entries.size() && entries[prunedEntries].pos.file < prunedFiles) prunedEntries++;
+    diskBytes = 0;
+    for (uint32_t file = prunedFiles; file <= currentFile; ++file) {
+        uint64_t size = std::filesystem::file_size(BlockFilePath(file), ec);
+        if (!ec) diskBytes += size;
+    }
+
+    if (!RecoverHeaders()) return false;
+
+    indexFile = fopen(IndexPath().c_str(), "ab");
+    headerFile = fopen(HeadersPath().c_str(), "ab");
+    if (!indexFile || !headerFile) {
+        std::cout << "[STORE] Cannot open the index files in " << dir << " for writing" << std::endl;
+        return false;
+    }
+    writerThread = std::thread(&BlockStore::WriterLoop, this);
+    return true;
+}
+
+bool BlockStore::RecoverTail() {
+    bool changed = false;
+    std::vector<uint8_t> data;
+
+    // Index entries are written after their block data, but without a sync
+    // in between the data may not have reached the disk. Drop such entries.
+    while (!entries.empty()) {
+        const Entry& e = entries.back();
+        FILE* f = fopen(BlockFilePath(e.pos.file).c_str(), "rb");
+        bool ok = f && e.pos.offset >= FRAME_HEADER_SIZE &&
+                  ReadFrame(f, e.pos.offset - FRAME_HEADER_SIZE, e.pos.length, data);
+        if (f) fclose(f);
+        if (ok) break;
+        std::cout << "[STORE] Dropping torn block " << e.hash.ToString() << " from the index" << std::endl;
+        entryIndex.erase(e.hash);
+        entries.pop_back();
+        changed = true;
+    }
+
+    // Walk the frames appended after the last indexed block: complete ones
+    // lost their index entry and are re-indexed, the first torn one and
+    // everything after it is truncated.
+    uint32_t file = entries.empty() ? 0 : entries.back().pos.file;
+    uint64_t offset = entries.empty() ? 0 : (uint64_t)entries.back().pos.offset + entries.back().pos.length;
+    std::error_code ec;
+    for (;;) {
+        std::string path = BlockFilePath(file);
+        uint64_t size = std::filesystem::file_size(path, ec);
+        if (ec) {
+            size = 0;
+            ec.clear();
+        }
+        bool torn = false;
+        FILE* f = size > offset ? fopen(path.c_str(), "rb") : nullptr;
+        while (f && offset < size) {
+            if (!ReadFrame(f, offset, 0, data)) {
+                torn = true;
+                break;
+            }
+            Entry e;
+            try {
+                Deserializer d(data);
+                BlockHeader header;
+                d >> header;
+                e.hash = header.GetHash();
+            } catch (const std::exception&) {
+                torn = true;
+                break;
+            }
+            e.pos = BlockPos(file, (uint32_t)(offset + FRAME_HEADER_SIZE), (uint32_t)data.size());
+            if (!entryIndex.count(e.hash)) {
+                std::cout << "[STORE] Re-indexing unindexed block " << e.hash.ToString() << std::endl;
+                entryIndex[e.hash] = entries.size();
+                entries.push_back(e);
+                changed = true;
+            }
+            offset += FRAME_HEADER_SIZE + data.size();
+        }
+        if (f) fclose(f);
+
+        if (torn || offset < size) {
+            std::cout << "[STORE] Truncating torn tail of " << path << " at " << offset << " bytes" << std::endl;
+            std::filesystem::resize_file(path, offset, ec);
+            if (ec) std::cout << "[STORE] Truncate failed: " << ec.message() << std::endl;
+            size = offset;
+        }
+        currentFile = file;
+        currentSize = (uint32_t)size;
+
+        // Anything in later files was written after the torn frame
+        std::string next = BlockFilePath(file + 1);
+        if (!std::filesystem::exists(next, ec)) break;
+        if (torn) {
+            for (uint32_t n = file + 1; std::filesystem::exists(BlockFilePath(n), ec); ++n) {
+                std::cout << "[STORE] Removing " << BlockFilePath(n) << " written past a torn frame" << std::endl;
+                std::filesystem::remove(BlockFilePath(n), ec);
+            }
+            break;
+        }
+        file++;
+        offset = 0;
+    }
+    return changed;
+}
+
+bool BlockStore::RecoverHeaders() {
+    // headers.dat trails index.dat: cut it back to whole records for known
+    // entries, then fill in any missing headers from the block files
+    std::error_code ec;
+    std::string path = HeadersPath();
+    uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec) size = 0;
+    size_t have = std::min<size_t>(size / HEADER_RECORD_SIZE, entries.size());
+    if (have == entries.size() && size == have * HEADER_RECORD_SIZE) return true;
+
+    if (size > 0) {
+        std::filesystem::resize_file(path, have * HEADER_RECORD_SIZE, ec);
+        if (ec) {
+            std::cout << "[STORE] Cannot truncate " << path << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+    FILE* out = fopen(path.c_str(), size > 0 ? "ab" : "wb");
+    if (!out) {
+        std::cout << "[STORE] Cannot open " << path << " for writing" << std::endl;
+        return false;
+    }
+    if (have < entries.size()) {
+        std::cout << "[STORE] Rebuilding " << (entries.size() - have) << " block headers from block files" << std::endl;
+    }
+    bool ok = true;
+    FILE* in = nullptr;
+    uint32_t inFile = 0;
+    uint8_t header[HEADER_RECORD_SIZE];
+    for (size_t i = have; ok && i < entries.size(); ++i) {
+        const BlockPos& pos = entries[i].pos;
+        if (!in || inFile != pos.file) {
+            if (in) fclose(in);
+            in = fopen(BlockFilePath(pos.file).c_str(), "rb");
+            inFile = pos.file;
+        }
+        ok = in && pos.length >= HEADER_RECORD_SIZE && fseek(in, (long)pos.offset, SEEK_SET) == 0 &&
+             fread(header, 1, sizeof(header), in) == sizeof(header) &&
+             fwrite(header, 1, sizeof(header), out) == sizeof(header);
+        if (!ok) std::cout << "[STORE] Cannot recover the header of block " << entries[i].hash.ToString() << std::endl;
+    }
+    if (in) fclose(in);
+    ok = SyncFile(out) && ok;
+    ok = (fclose(out) == 0) && ok;
+    return ok;
+}
+
+bool BlockStore::WriteBlock(std::shared_ptr<const Block> block, const uint256& hash) {
+    if (Contains(hash)) return true;
+
+    // Frame the block outside the lock: magic, length, checksum, data
+    Serializer s;
+    s << BLOCK_FILE_MAGIC << (uint32_t)0 << (uint32_t)0;
+    s << *block;
+    uint32_t length = (uint32_t)(s.buffer.size() - FRAME_HEADER_SIZE);
+    PutLE32(s.buffer.data() + 4, length);
+    PutLE32(s.buffer.data() + 8, FrameChecksum(s.buffer.data() + FRAME_HEADER_SIZE, length));
+
+    std::unique_lock<std::mutex> lock(storeMutex);
+    if (entryIndex.count(hash)) return true;
+
+    if (currentSize > 0 && (uint64_t)currentSize + s.buffer.size() > maxFileSize) {
+        currentFile++;
+        currentSize = 0;
+    }
+
+    PendingWrite w;
+    w.entry.hash = hash;
+    w.entry.pos = BlockPos(currentFile, currentSize + (uint32_t)FRAME_HEADER_SIZE, length);
+    w.block = std::move(block);
+    w.frame = std::move(s.buffer);
+    currentSize += (uint32_t)w.frame.size();
+    diskBytes += w.frame.size();
+
+    entryIndex[hash] = entries.size();
+    entries.push_back(w.entry);
+    pendingBlocks[hash] = w.block;
+    writeQueue.push_back(std::move(w));
+    uint64_t seq = ++queuedSeq;
+    writerWake.notify_one();
+
+    if (syncPolicy == FsyncPolicy::Always && writerThread.joinable()) {
+        writeDone.wait(lock, [&] { return syncedSeq >= seq || stopWriter; });
+    }
+    return !writeError;
+}
+
+bool BlockStore::Flush() {
+    std::unique_lock<std::mutex> lock(storeMutex);
+    if (!writerThread.joinable()) return !writeError;
+    uint64_t target = queuedSeq;
+    syncRequested = true;
+    writerWake.notify_one();
+    writeDone.wait(lock, [&] { return syncedSeq >= target || stopWriter; });
+    return !writeError;
+}
+
+void BlockStore::WaitForWriter(std::unique_lock<std::mutex>& lock) const {
+    if (!writerThread.joinable()) return;
+    writeDone.wait(lock, [&] { return writtenSeq >= queuedSeq || stopWriter; });
+}
+
+void BlockStore::WriterLoop() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration interval = std::chrono::milliseconds(syncIntervalMs);
+    Clock::time_point lastSync = Clock::now();
+
+    std::unique_lock<std::mutex> lock(storeMutex);
+    for (;;) {
+        auto intervalDue = [&] {
+            return syncPolicy == FsyncPolicy::Interval && writtenSeq > syncedSeq && Clock::now() >= lastSync + interval;
+        };
+        while (writeQueue.empty() && !stopWriter && !syncRequested && !intervalDue()) {
+            if (syncPolicy == FsyncPolicy::Interval && writtenSeq > syncedSeq) {
+                writerWake.wait_until(lock, lastSync + interval);
+            } else {
+                writerWake.wait(lock);
+            }
+        }
+        bool finalSync = stopWriter && writtenSeq > syncedSeq && syncPolicy != FsyncPolicy::Never;
+        if (stopWriter && writeQueue.empty() && !finalSync && !syncRequested) break;
+
+        // Group commit: take everything queued so far as one batch
+        std::vector<PendingWrite> batch;
+        batch.swap(writeQueue);
+        uint64_t batchEnd = writtenSeq + batch.size();
+        bool sync = syncPolicy == FsyncPolicy::Always || syncRequested || finalSync ||
+                    (syncPolicy == FsyncPolicy::Interval && Clock::now() >= lastSync + interval);
+        syncRequested = false;
+
+        lock.unlock();
+        bool ok = WriteBatch(batch, sync);
+        lock.lock();
+
+        writtenSeq = batchEnd;
+        if (sync) {
+            syncedSeq = batchEnd;
+            lastSync = Clock::now();
+        }
+        if (!ok) writeError = true;
+        // Freshly written blocks are the likeliest to be read next
+        for (auto& w : batch) {
+            pendingBlocks.erase(w.entry.hash);
+            if (!cacheMap.count(w.entry.hash)) CacheInsert(w.entry.hash, w.block, EstimateBlockMemory(*w.block));
+        }
+        writeDone.notify_all();
+    }
+}
+
+bool BlockStore::WriteBatch(std::vector<PendingWrite>& batch, bool sync) {
+    bool ok = true;
+    std::vector<uint8_t> buf;
+    size_t i = 0;
+    while (i < batch.size()) {
+        uint32_t file = batch[i].entry.pos.file;
+        if (!blockFile || blockFileNum != file) {
+            if (blockFile) {
+                // Leaving this file for good: make it durable first
+                if (syncPolicy != FsyncPolicy::Never) ok = SyncFile(blockFile) && ok;
+                ok = (fclose(blockFile) == 0) && ok;
+            }
+            // The first frame of a file starts a fresh file
+            bool fresh = batch[i].entry.pos.offset == FRAME_HEADER_SIZE;
+            blockFile = fopen(BlockFilePath(file).c_str(), fresh ? "wb" : "ab");
+            blockFileNum = file;
+            if (!blockFile) {
+                std::cout << "[STORE] Cannot open " << BlockFilePath(file) << " for writing" << std::endl;
+                return false;
+            }
+        }
+        // One write per file per batch
+        buf.clear();
+        for (; i < batch.size() && batch[i].entry.pos.file == file; ++i) {
+            buf.insert(buf.end(), batch[i].frame.begin(), batch[i].frame.end());
+        }
+        if (fwrite(buf.data(), 1, buf.size(), blockFile) != buf.size()) {
+            std::cout << "[STORE] Write failed on " << BlockFilePath(file) << std::endl;
+            ok = false;
+        }
+    }
+    if (blockFile) ok = (sync ? SyncFile(blockFile) : fflush(blockFile) == 0) && ok;
+
+    // Index records go out after the block data they point to
+    Serializer rec;
+    for (const auto& w : batch) {
+        rec.write(w.entry.hash.data.data(), w.entry.hash.data.size());
+        rec << w.entry.pos.file << w.entry.pos.offset << w.entry.pos.length;
+    }
+    if (!rec.buffer.empty() && fwrite(rec.buffer.data(), 1, rec.buffer.size(), indexFile) != rec.buffer.size()) {
+        std::cout << "[STORE] Index write failed" << std::endl;
+        ok = false;
+    }
+    ok = (sync ? SyncFile(indexFile) : fflush(indexFile) == 0) && ok;
+
+    // Headers last: a missing tail is rebuilt from the block data on open
+    rec.buffer.clear();
+    for (const auto& w : batch) {
+        rec.write(w.frame.data() + FRAME_HEADER_SIZE, HEADER_RECORD_SIZE);
+    }
+    if (!rec.buffer.empty() && fwrite(rec.buffer.data(), 1, rec.buffer.size(), headerFile) != rec.buffer.size()) {
+        std::cout << "[STORE] Header write failed" << std::endl;
+        ok = false;
+    }
+    ok = (sync ? SyncFile(headerFile) : fflush(headerFile) == 0) && ok;
+    return ok;
+}
+
+bool BlockStore::ReadFromDisk(const BlockPos& pos, Block& block) const {
+    FILE* f = fopen(BlockFilePath(pos.file).c_str(), "rb");
+    if (!f) return false;
+    std::vector<uint8_t> buf;
+    bool ok = pos.offset >= FRAME_HEADER_SIZE && ReadFrame(f, pos.offset - FRAME_HEADER_SIZE, pos.length, buf);
+    fclose(f);
+    if (!ok) return false;
+    try {
+        Deserializer d(buf);
+        d >> block;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+void BlockStore::CacheInsert(const uint256& hash, std::shared_ptr<const Block> block, size_t bytes) const {
+    if (bytes > cacheBytes) return;
+    lru.push_front({hash, std::move(block), bytes});
+    cacheMap[hash] = lru.begin();
+    cacheUsed += bytes;
+    while (cacheUsed > cacheBytes && !lru.empty()) {
+        cacheUsed -= lru.back().bytes;
+        cacheMap.erase(lru.back().hash);
+        lru.pop_back();
+    }
+}
+
+std::shared_ptr<const Block> BlockStore::ReadBlock(const uint256& hash) const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto cached = cacheMap.find(hash);
+    if (cached != cacheMap.end()) {
+        lru.splice(lru.begin(), lru, cached->second);
+        return cached->second->block;
+    }
+
+    auto pending = pendingBlocks.find(hash);
+    if (pending != pendingBlocks.end()) return pending->second;
+
+    auto it = entryIndex.find(hash);
+    if (it == entryIndex.end() || it->second < prunedEntries) return nullptr;
+
+    auto block = std::make_shared<Block>();
+    if (!ReadFromDisk(entries[it->second].pos, *block)) {
+        std::cout << "[STORE] Failed to read block " << hash.ToString() << std::endl;
+        return nullptr;
+    }
+    CacheInsert(hash, block, EstimateBlockMemory(*block));
+    return block;
+}
+
+void BlockStore::ForEachRecord(const std::function<bool(const BlockRecord&)>& fn, size_t first) const {
+    std::vector<Entry> snapshot;
+    {
+        // Queued blocks must reach the files before they can be mapped
+        std::unique_lock<std::mutex> lock(storeMutex);
+        WaitForWriter(lock);
+        if (first < entries.size()) snapshot.assign(entries.begin() + first, entries.end());
+    }
+
+    // Each block file is mapped once; records point straight into the
+    // mapping, so no raw block bytes are copied.
+    std::shared_ptr<MappedFile> map;
+    uint32_t openFile = 0;
+    for (const auto& e : snapshot) {
+        if (!map || openFile != e.pos.file) {
+            openFile = e.pos.file;
+            map = std::make_shared<MappedFile>();
+            if (!map->Open(BlockFilePath(e.pos.file))) {
+                std::cout << "[STORE] Missing block file " << BlockFilePath(e.pos.file) << std::endl;
+                return;
+            }
+        }
+        if ((uint64_t)e.pos.offset + e.pos.length > map->size()) {
+            std::cout << "[STORE] Truncated block " << e.hash.ToString() << ", stopping scan" << std::endl;
+            return;
+        }
+        BlockRecord rec;
+        rec.hash = e.hash;
+        rec.file = map;
+        rec.data = map->data() + e.pos.offset;
+        rec.length = e.pos.length;
+        if (!fn(rec)) return;
+    }
+}
+
+void BlockStore::ForEachBlock(const std::function<bool(const uint256&, Block&)>& fn, size_t first) const {
+    ForEachRecord([&](const BlockRecord& rec) {
+        Block block;
+        try {
+            Deserializer d(rec.data, rec.length);
+            d >> block;
+        } catch (const std::exception&) {
+            std::cout << "[STORE] Unreadable block " << rec.hash.ToString() << ", stopping scan" << std::endl;
+            return false;
+        }
+        return fn(rec.hash, block);
+    }, first);
+}
+
+void BlockStore::ForEachHeader(const std::function<bool(const uint256&, const BlockHeader&)>& fn) const {
+    std::vector<Entry> snapshot;
+    {
+        std::unique_lock<std::mutex> lock(storeMutex);
+        WaitForWriter(lock);
+        snapshot = entries;
+    }
+
+    MappedFile map;
+    if (!map.Open(HeadersPath())) {
+        std::cout << "[STORE] Cannot read " << HeadersPath() << std::endl;
+        return;
+    }
+    size_t count = std::min(snapshot.size(), map.size() / HEADER_RECORD_SIZE);
+    for (size_t i = 0; i < count; ++i) {
+        Deserializer d(map.data() + i * HEADER_RECORD_SIZE, HEADER_RECORD_SIZE);
+        BlockHeader header;
+        d >> header;
+        if (!fn(snapshot[i].hash, header)) return;
+    }
+}
+
+bool BlockStore::Contains(const uint256& hash) const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return entryIndex.count(hash) > 0;
+}
+
+size_t BlockStore::Size() const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return entries.size();
+}
+
+bool BlockStore::GetPos(const uint256& hash, BlockPos& pos) const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto it = entryIndex.find(hash);
+    if (it == entryIndex.end()) return false;
+    pos = entries[it->second].pos;
+    return true;
+}
+
+int BlockStore::Prune(uint64_t targetBytes, size_t keepFrom) {
+    // Everything queued must be on disk (headers included) before the
+    // block data behind it can go
+    Flush();
+    std::unique_lock<std::mutex> lock(storeMutex);
+    WaitForWriter(lock);
+
+    int removed = 0;
+    std::error_code ec;
+    while (diskBytes > targetBytes && prunedFiles < currentFile) {
+        size_t end = prunedEntries;
+        while (end < entries.size() && entries[end].pos.file == prunedFiles) end++;
+        if (end > keepFrom) break;
+
+        std::string path = BlockFilePath(prunedFiles);
+        uint64_t size = std::filesystem::file_size(path, ec);
+        if (ec) size = 0;
+        std::filesystem::remove(path, ec);
+        if (ec) {
+            std::cout << "[STORE] Cannot remove " << path << ": " << ec.message() << std::endl;
+            break;
+        }
+        diskBytes -= std::min(diskBytes, size);
+        for (size_t i = prunedEntries; i < end; ++i) {
+            auto cached = cacheMap.find(entries[i].hash);
+            if (cached == cacheMap.end()) continue;
+            cacheUsed -= cached->second->bytes;
+            lru.erase(cached->second);
+            cacheMap.erase(cached);
+        }
+        prunedFiles++;
+        prunedEntries = end;
+        removed++;
+    }
+    return removed;
+}
+
+bool BlockStore::Truncate(size_t count) {
+    std::unique_lock<std::mutex> lock(storeMutex);
+    WaitForWriter(lock);
+    if (count >= entries.size()) return true;
+    if (prunedEntries > 0 && count <= prunedEntries) {
+        std::cout << "[STORE] Cannot truncate to " << count << " blocks: data below " << prunedEntries << " is pruned" << std::endl;
+        return false;
+    }
+
+    // The writer is idle and cannot start a batch while we hold the lock;
+    // it reopens the block file on its next write
+    if (blockFile) {
+        fclose(blockFile);
+        blockFile = nullptr;
+    }
+    uint32_t file = count > 0 ? entries[count - 1].pos.file : 0;
+    uint64_t end = count > 0 ? (uint64_t)entries[count - 1].pos.offset + entries[count - 1].pos.length : 0;
+    std::error_code ec;
+    bool ok = true;
+    auto cut = [&](const std::string& path, uint64_t size) {
+        if (!std::filesystem::exists(path, ec)) return;
+        std::filesystem::resize_file(path, size, ec);
+        if (ec) {
+            std::cout << "[STORE] Cannot truncate " << path << ": " << ec.message() << std::endl;
+            ok = false;
+        }
+    };
+    // Index and headers first: a block file longer than its index is
+    // re-indexed on open, an index pointing past its block file is not
+    cut(IndexPath(), count * INDEX_RECORD_SIZE);
+    cut(HeadersPath(), count * HEADER_RECORD_SIZE);
+    if (!ok) return false;
+    cut(BlockFilePath(file), end);
+    for (uint32_t n = file + 1; n <= currentFile; ++n) {
+        std::filesystem::remove(BlockFilePath(n), ec);
+        if (ec) {
+            std::cout << "[STORE] Cannot remove " << BlockFilePath(n) << ": " << ec.message() << std::endl;
+            ok = false;
+        }
+    }
+
+    for (size_t i = count; i < entries.size(); ++i) {
+        entryIndex.erase(entries[i].hash);
+        auto cached = cacheMap.find(entries[i].hash);
+        if (cached == cacheMap.end()) continue;
+        cacheUsed -= cached->second->bytes;
+        lru.erase(cached->second);
+        cacheMap.erase(cached);
+    }
+    entries.resize(count);
+    currentFile = file;
+    currentSize = (uint32_t)end;
+    diskBytes = 0;
+    for (uint32_t n = prunedFiles; n <= currentFile; ++n) {
+        uint64_t size = std::filesystem::file_size(BlockFilePath(n), ec);
+        if (!ec) diskBytes += size;
+    }
+    return ok;
+}
+
+size_t BlockStore::PrunedCount() const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return prunedEntries;
+}
+
+bool BlockStore::IsPruned(const uint256& hash) const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto it = entryIndex.find(hash);
+    return it != entryIndex.end() && it->second < prunedEntries;
+}
+
+uint64_t BlockStore::DiskUsage() const {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    return diskBytes;
+}
+
+} // namespace aurelis
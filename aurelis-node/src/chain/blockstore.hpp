@@ -0,0 +1,188 @@
+#pragma once
+
+#include "chain/block.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace aurelis {
+
+// Location of a serialized block inside the segmented block files.
+struct BlockPos {
+    uint32_t file;
+    uint32_t offset; // start of the serialized block (after the record header)
+    uint32_t length;
+
+    BlockPos() : file(0), offset(0), length(0) {}
+    BlockPos(uint32_t f, uint32_t o, uint32_t l) : file(f), offset(o), length(l) {}
+};
+
+class MappedFile;
+
+// Raw serialized block inside a mapped block file. Holding `file` keeps the
+// mapping, and therefore `data`, valid.
+struct BlockRecord {
+    uint256 hash;
+    std::shared_ptr<const MappedFile> file;
+    const uint8_t* data;
+    size_t length;
+};
+
+// When the block writer forces appended data to stable storage.
+enum class FsyncPolicy {
+    Always,   // every batch; WriteBlock returns once its block is durable
+    Interval, // at most once per sync interval
+    Never     // leave it to the OS (explicit Flush() still syncs)
+};
+
+// Append-only block storage.
+//
+// Blocks are appended to blocks/blkNNNNN.dat, rotating to a new file once the
+// current one reaches maxFileSize. Each block is framed as magic, length and
+// a 4-byte checksum (first bytes of its Hash256) so a torn tail can be told
+// apart from a complete record. A parallel blocks/index.dat records
+// hash -> (file, offset, length) in append order, which is also chain order,
+// and blocks/headers.dat keeps each block's 80-byte header in the same
+// order so headers outlive pruned block files.
+//
+// Appends are queued to a writer thread that group-commits whatever has
+// accumulated with one write per file and one sync per batch. Reads go
+// through a byte-budgeted LRU cache of deserialized blocks, so resident memory
+// is bounded by the cache size rather than chain length.
+class BlockStore {
+public:
+    BlockStore(const std::string& dir, size_t cacheBytes, uint32_t maxFileSize,
+               FsyncPolicy policy = FsyncPolicy::Interval, int syncIntervalMs = 1000);
+    ~BlockStore();
+
+    BlockStore(const BlockStore&) = delete;
+    BlockStore& operator=(const BlockStore&) = delete;
+
+    // Load the index, truncate any torn tail left by a crash and start the
+    // writer; returns false if the directory cannot be used.
+    bool Open();
+
+    // Queue a block for appending (no-op if already stored). It is readable
+    // immediately, as the same shared object; with FsyncPolicy::Always this
+    // also waits until it is durable.
+    bool WriteBlock(std::shared_ptr<const Block> block, const uint256& hash);
+
+    // Wait until every queued block is written and synced to disk. False
+    // if any write has failed since Open (the error is sticky).
+    bool Flush();
+
+    // Cached read; nullptr if unknown or unreadable.
+    std::shared_ptr<const Block> ReadBlock(const uint256& hash) const;
+
+    // Visit every stored block from position `first` on, in append order,
+    // without populating the cache. Stops early when the callback returns false.
+    void ForEachBlock(const std::function<bool(const uint256&, Block&)>& fn, size_t first = 0) const;
+
+    // Zero-copy variant: hands out the raw bytes of each stored block from
+    // position `first` on without decoding them.
+    void ForEachRecord(const std::function<bool(const BlockRecord&)>& fn, size_t first = 0) const;
+
+    // Visit every stored header in append order, read from headers.dat, so
+    // block files (pruned or not) are never touched.
+    void ForEachHeader(const std::function<bool(const uint256&, const BlockHeader&)>& fn) const;
+
+    bool Contains(const uint256& hash) const;
+    size_t Size() const;
+    bool GetPos(const uint256& hash, BlockPos& pos) const;
+
+    // Delete the oldest block files while the files on disk exceed
+    // `targetBytes`, never touching a file holding a block at position
+    // `keepFrom` or later, nor the file being appended to. Returns the
+    // number of files removed.
+    int Prune(uint64_t targetBytes, size_t keepFrom);
+    // Forget every block from position `count` on: index.dat, headers.dat
+    // and the block files are cut back to end at block count - 1, so the
+    // next append follows it and append order stays chain order. Fails
+    // (changing nothing) if that would reach into pruned files.
+    bool Truncate(size_t count);
+    // Blocks whose data has been pruned: positions [0, PrunedCount())
+    size_t PrunedCount() const;
+    bool IsPruned(const uint256& hash) const;
+    // Bytes held by the block files still on disk
+    uint64_t DiskUsage() const;
+
+private:
+    struct Entry {
+        uint256 hash;
+        BlockPos pos;
+    };
+
+    struct CacheItem {
+        uint256 hash;
+        std::shared_ptr<const Block> block;
+        size_t bytes;
+    };
+
+    struct PendingWrite {
+        Entry entry;
+        std::shared_ptr<const Block> block;
+        std::vector<uint8_t> frame;
+    };
+
+    std::string dir;
+    size_t cacheBytes;
+    uint32_t maxFileSize;
+    FsyncPolicy syncPolicy;
+    int syncIntervalMs;
+
+    std::vector<Entry> entries;
+    std::unordered_map<uint256, size_t, Uint256Hasher> entryIndex;
+    uint32_t currentFile;
+    uint32_t currentSize;
+    uint32_t prunedFiles;  // blkNNNNN.dat below this number are gone
+    size_t prunedEntries;  // leading entries stored in those files
+    uint64_t diskBytes;
+
+    // LRU: most recently used at the front
+    mutable std::list<CacheItem> lru;
+    mutable std::unordered_map<uint256, std::list<CacheItem>::iterator, Uint256Hasher> cacheMap;
+    mutable size_t cacheUsed;
+
+    mutable std::mutex storeMutex;
+
+    // Writer thread state, guarded by storeMutex. Sequence numbers count
+    // queued blocks; written/synced trail queued as the writer catches up.
+    std::vector<PendingWrite> writeQueue;
+    std::unordered_map<uint256, std::shared_ptr<const Block>, Uint256Hasher> pendingBlocks;
+    uint64_t queuedSeq;
+    uint64_t writtenSeq;
+    uint64_t syncedSeq;
+    bool syncRequested;
+    bool stopWriter;
+    bool writeError; // sticky: reported by later WriteBlock calls
+    mutable std::condition_variable writerWake;
+    mutable std::condition_variable writeDone;
+    std::thread writerThread;
+
+    // Only touched by the writer thread
+    FILE* blockFile;
+    uint32_t blockFileNum;
+    FILE* indexFile;
+    FILE* headerFile;
+
+    std::string BlockFilePath(uint32_t file) const;
+    std::string IndexPath() const;
+    std::string HeadersPath() const;
+    bool RecoverTail();
+    bool RecoverHeaders();
+    void WriterLoop();
+    bool WriteBatch(std::vector<PendingWrite>& batch, bool sync);
+    void WaitForWriter(std::unique_lock<std::mutex>& lock) const;
+    bool ReadFromDisk(const BlockPos& pos, Block& block) const;
+    void CacheInsert(const uint256& hash, std::shared_ptr<const Block> block, size_t length) const;
+};
+
+} // namespace aurelis
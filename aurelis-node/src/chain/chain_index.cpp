@@ -0,0 +1,67 @@
+#include "chain/chain_index.hpp"
+#include <cstring>
+#include <random>
+
+namespace aurelis {
+
+namespace {
+const size_t MIN_SLOTS = 64;
+}
+
+ChainIndex::ChainIndex() : mask(0) {
+    std::random_device rd;
+    salt = ((uint64_t)rd() << 32) | rd();
+}
+
+size_t ChainIndex::HomeSlot(const uint256& hash) const {
+    // Proof of work zeroes the leading bytes; the trailing ones are uniform
+    uint64_t x;
+    memcpy(&x, hash.data.data() + uint256::WIDTH - sizeof(x), sizeof(x));
+    x = (x ^ salt) * 0x9e3779b97f4a7c15ULL;
+    return (size_t)(x ^ (x >> 32)) & mask;
+}
+
+void ChainIndex::Rehash(size_t capacity) {
+    slots.assign(capacity, 0);
+    mask = capacity - 1;
+    for (size_t h = 0; h < entries.size(); ++h) {
+        size_t i = HomeSlot(entries[h].hash);
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = (int32_t)h + 1;
+    }
+}
+
+void ChainIndex::Reserve(size_t count) {
+    entries.reserve(count);
+    size_t capacity = MIN_SLOTS;
+    while (capacity < count * 2) capacity *= 2;
+    if (capacity > slots.size()) Rehash(capacity);
+}
+
+int ChainIndex::Find(const uint256& hash) const {
+    if (slots.empty()) return -1;
+    for (size_t i = HomeSlot(hash); slots[i] != 0; i = (i + 1) & mask) {
+        int height = slots[i] - 1;
+        if (entries[height].hash == hash) return height;
+    }
+    return -1;
+}
+
+int ChainIndex::Push(const BlockHeader& header, const uint256& hash) {
+    // Keep the table at most half full so probes stay short
+    if ((entries.size() + 1) * 2 > slots.size()) Rehash(slots.empty() ? MIN_SLOTS : slots.size() * 2);
+    int height = (int)entries.size();
+    entries.emplace_back(header, hash, height);
+    size_t i = HomeSlot(hash);
+    while (slots[i] != 0) i = (i + 1) & mask;
+    slots[i] = height + 1;
+    return height;
+}
+
+void ChainIndex::Truncate(size_t size) {
+    if (size >= entries.size()) return;
+    entries.erase(entries.begin() + size, entries.end());
+    Rehash(slots.size());
+}
+
+} // namespace aurelis
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "chain/block.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace aurelis {
+
+struct BlockIndex {
+    uint256 hash;
+    BlockHeader header;
+    int height;
+
+    BlockIndex() : height(-1) {}
+    BlockIndex(const Block& block, int h) : header(block.header), height(h) {
+        hash = block.header.GetHash(); // cached on the source block
+    }
+    BlockIndex(const BlockHeader& hdr, const uint256& h, int ht) : hash(h), header(hdr), height(ht) {}
+};
+
+// The active chain as one contiguous, height-addressed array of BlockIndex
+// entries plus an open-addressing table from block hash to height.
+//
+// Heights are the handles: they stay valid as the chain grows (only
+// Truncate invalidates the ones it removes). A hash lookup probes a flat
+// array of 4-byte slots and touches a single entry, with no per-block heap
+// allocation or reference counting.
+class ChainIndex {
+public:
+    ChainIndex();
+
+    size_t Size() const { return entries.size(); }
+    bool Empty() const { return entries.empty(); }
+    int Height() const { return (int)entries.size() - 1; }
+
+    // Callers check bounds / Empty() first
+    const BlockIndex& operator[](size_t height) const { return entries[height]; }
+    const BlockIndex& Tip() const { return entries.back(); }
+
+    // Height of `hash`, or -1 if it is not on the chain
+    int Find(const uint256& hash) const;
+    bool Contains(const uint256& hash) const { return Find(hash) >= 0; }
+
+    // Append the next block; returns its height
+    int Push(const BlockHeader& header, const uint256& hash);
+    // Drop every entry at or above `size`
+    void Truncate(size_t size);
+    void Reserve(size_t count);
+
+private:
+    std::vector<BlockIndex> entries;
+    std::vector<int32_t> slots; // height + 1, 0 marks a free slot; size is a power of two
+    size_t mask;
+    uint64_t salt;
+
+    size_t HomeSlot(const uint256& hash) const;
+    void Rehash(size_t capacity);
+};
+
+} // namespace aurelis
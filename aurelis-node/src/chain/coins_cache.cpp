@@ -0,0 +1,76 @@
+#include "chain/coins_cache.hpp"
+#include <cstring>
+
+namespace aurelis {
+
+namespace {
+// Node, bucket and allocator overhead of one entry in `erased`
+const size_t ERASED_ENTRY_BYTES = sizeof(OutPoint) + 3 * sizeof(void*) + 16;
+// Node, string and vector overhead of one script in `dirtyByScript`
+const size_t SCRIPT_ENTRY_BYTES = sizeof(std::string) + sizeof(std::vector<OutPoint>) + 3 * sizeof(void*) + 16;
+}
+
+CoinsCache::CoinsCache(CoinsDB& database) : db(database), dirtyByScriptBytes(0) {}
+
+bool CoinsCache::Get(const OutPoint& op, TxOut& out) const {
+    CoinView coin;
+    if (dirty.Find(op, coin)) {
+        out = coin.ToTxOut();
+        return true;
+    }
+    if (erased.count(op)) return false;
+    return db.Get(op, out);
+}
+
+void CoinsCache::Add(const OutPoint& op, const TxOut& out) {
+    // An erase already queued for `op` is written before the new coin, so
+    // it stays queued
+    dirty.Insert(op, out);
+    auto entry = dirtyByScript.try_emplace(std::string((const char*)out.scriptPubKey.data(), out.scriptPubKey.size()));
+    if (entry.second) dirtyByScriptBytes += SCRIPT_ENTRY_BYTES + out.scriptPubKey.size();
+    std::vector<OutPoint>& ops = entry.first->second;
+    if (ops.size() == ops.capacity()) dirtyByScriptBytes += (ops.capacity() ? ops.capacity() : 1) * sizeof(OutPoint);
+    ops.push_back(op);
+}
+
+void CoinsCache::Spend(const OutPoint& op) {
+    dirty.Erase(op);
+    if (db.MayContain(op)) erased.insert(op);
+}
+
+bool CoinsCache::ForEachWithScript(const std::string& script, const std::function<void(const OutPoint&, const CoinView&)>& fn) const {
+    bool ok = db.ForEachWithScript(script, [&](const OutPoint& op, const CoinView& coin) {
+        CoinView pending;
+        if (erased.count(op) || dirty.Find(op, pending)) return;
+        fn(op, coin);
+    });
+    auto it = dirtyByScript.find(script);
+    if (it == dirtyByScript.end()) return ok;
+    for (const OutPoint& op : it->second) {
+        CoinView coin;
+        // Spent since, or replaced by a coin paying another script
+        if (!dirty.Find(op, coin) || coin.scriptLen != script.size() || memcmp(coin.script, script.data(), script.size()) != 0) continue;
+        fn(op, coin);
+    }
+    return ok;
+}
+
+bool CoinsCache::Flush(const uint256& bestHash, int height) {
+    if (!db.Commit(erased, dirty, bestHash, height)) return false;
+    Clear();
+    return true;
+}
+
+void CoinsCache::Clear() {
+    dirty.Clear();
+    OutPointSet().swap(erased);
+    std::unordered_map<std::string, std::vector<OutPoint>>().swap(dirtyByScript);
+    dirtyByScriptBytes = 0;
+}
+
+size_t CoinsCache::MemoryUsage() const {
+    return dirty.MemoryUsage() + erased.size() * ERASED_ENTRY_BYTES + erased.bucket_count() * sizeof(void*) +
+           dirtyByScriptBytes + dirtyByScript.bucket_count() * sizeof(void*);
+}
+
+} // namespace aurelis
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "chain/coins_db.hpp"
+#include "chain/utxo_table.hpp"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace aurelis {
+
+// Write-back coin cache in front of a CoinsDB.
+//
+// Coins created since the last flush live in `dirty`, and are also listed
+// by script so an address's pending coins are found without a scan; spends
+// of coins the database may hold are remembered in `erased`. A coin created and spent
+// between two flushes never reaches the disk. Flush() writes both sets as
+// one commit and empties the cache, so its footprint is bounded by how
+// often the owner flushes against MemoryUsage().
+class CoinsCache {
+public:
+    explicit CoinsCache(CoinsDB& db);
+
+    bool Get(const OutPoint& op, TxOut& out) const;
+    // Insert, replacing any coin already at `op`
+    void Add(const OutPoint& op, const TxOut& out);
+    void Spend(const OutPoint& op);
+
+    // Visit the coins paying exactly `script` as Get() sees them: stored
+    // coins neither spent nor replaced here, following the database's
+    // chain for the script, then the pending ones. A coin created twice
+    // since the last flush may be visited twice. False if a stored coin
+    // cannot be read back.
+    bool ForEachWithScript(const std::string& script, const std::function<void(const OutPoint&, const CoinView&)>& fn) const;
+
+    // Commit pending changes as the state at `bestHash` and empty the cache
+    bool Flush(const uint256& bestHash, int height);
+    // Forget pending changes without writing them
+    void Clear();
+
+    size_t MemoryUsage() const;
+    size_t DirtyCount() const { return dirty.Size(); }
+
+private:
+    CoinsDB& db;
+    UTXOTable dirty;
+    OutPointSet erased;
+    // Outpoints added to `dirty` per script; spent ones stay until the
+    // flush and are skipped when `dirty` no longer has them
+    std::unordered_map<std::string, std::vector<OutPoint>> dirtyByScript;
+    size_t dirtyByScriptBytes;
+};
+
+} // namespace aurelis
@@ -0,0 +1,530 @@
+#include "chain/coins_db.hpp"
+#include "util/mapped_file.hpp"
+#include "util/serialize.hpp"
+#include "util/sha256.hpp"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+
+namespace aurelis {
+
+namespace {
+
+const uint32_t COINS_MAGIC = 0x4155434F; // "AUCO"
+const uint32_t COINS_VERSION = 2;
+const size_t HEADER_SIZE = 8;
+
+const uint8_t RECORD_PUT = 'P';    // txid, n, previous put for the script, TxOut
+const uint8_t RECORD_ERASE = 'E';  // txid, n
+const uint8_t RECORD_COMMIT = 'C'; // batch length, checksum, best hash, height
+
+const size_t KEY_SIZE = 32 + 4;
+const size_t PUT_HEADER_SIZE = 1 + KEY_SIZE + 8 + 8 + 8;
+const size_t MIN_INDEX_SIZE = 1024;
+const uint64_t MIN_COMPACT_RECORDS = 1 << 20;
+const size_t COMPACT_BATCH_BYTES = 4 * 1024 * 1024;
+// Node, bucket and allocator overhead of one script head
+const size_t HEAD_ENTRY_BYTES = 2 * sizeof(uint64_t) + 2 * sizeof(void*) + 16;
+
+uint64_t ScriptHash(const uint8_t* script, size_t len) {
+    return std::hash<std::string_view>()(std::string_view((const char*)script, len));
+}
+
+// Offset a put for `hash` links back to, given the heads so far
+uint64_t PreviousPut(const std::unordered_map<uint64_t, uint64_t>& heads, uint64_t hash) {
+    auto it = heads.find(hash);
+    return it != heads.end() ? it->second : 0;
+}
+
+uint32_t BatchChecksum(const uint8_t* data, size_t len) {
+    uint8_t hash[32];
+    Hash256(data, len, hash);
+    return (uint32_t)hash[0] | ((uint32_t)hash[1] << 8) | ((uint32_t)hash[2] << 16) | ((uint32_t)hash[3] << 24);
+}
+
+void WritePut(Serializer& s, const OutPoint& op, uint64_t prev, const CoinView& coin) {
+    s << RECORD_PUT;
+    s.write(op.hash.data.data(), op.hash.data.size());
+    s << op.n << prev << coin.value << (uint64_t)coin.scriptLen;
+    s.write(coin.script, coin.scriptLen);
+}
+
+void WriteCommit(Serializer& s, size_t batchStart, const uint256& bestHash, int height) {
+    uint64_t batchLen = s.buffer.size() - batchStart;
+    s << RECORD_COMMIT << batchLen << BatchChecksum(s.buffer.data() + batchStart, batchLen);
+    s.write(bestHash.data.data(), bestHash.data.size());
+    s << (int32_t)height;
+}
+
+// Parse one record at d.pos. Puts leave `script` pointing into the buffer.
+uint8_t ParseRecord(Deserializer& d, OutPoint& op, uint64_t& prev, int64_t& value, const uint8_t*& script, uint64_t& scriptLen,
+                    uint64_t& batchLen, uint32_t& checksum, uint256& bestHash, int32_t& height) {
+    uint8_t type;
+    d >> type;
+    if (type == RECORD_PUT || type == RECORD_ERASE) {
+        d.read(op.hash.data.data(), op.hash.data.size());
+        d >> op.n;
+        if (type == RECORD_PUT) {
+            d >> prev >> value >> scriptLen;
+            if (scriptLen > d.remaining()) throw std::runtime_error("Deserialize underflow");
+            script = d.data + d.pos;
+            d.pos += scriptLen;
+        }
+    } else if (type == RECORD_COMMIT) {
+        d >> batchLen >> checksum;
+        d.read(bestHash.data.data(), bestHash.data.size());
+        d >> height;
+    } else {
+        throw std::runtime_error("Unknown coin record");
+    }
+    return type;
+}
+
+} // namespace
+
+CoinsDB::CoinsDB(const std::string& p)
+    : path(p), appendFile(nullptr), readFile(nullptr), fileSize(0), mask(0), count(0), staleRecords(0),
+      bestHeight(-1), window(nullptr), windowStart(0), windowSize(0) {}
+
+CoinsDB::~CoinsDB() {
+    CloseHandles();
+}
+
+bool CoinsDB::OpenHandles() {
+    appendFile = fopen(path.c_str(), "ab");
+    readFile = fopen(path.c_str(), "rb");
+    if (!appendFile || !readFile) {
+        std::cout << "[COINS] Cannot open " << path << std::endl;
+        CloseHandles();
+        return false;
+    }
+    return true;
+}
+
+void CoinsDB::CloseHandles() {
+    if (appendFile) fclose(appendFile);
+    if (readFile) fclose(readFile);
+    appendFile = nullptr;
+    readFile = nullptr;
+}
+
+bool CoinsDB::Create() {
+    CloseHandles();
+    index.clear();
+    mask = 0;
+    count = 0;
+    scriptHeads.clear();
+    staleRecords = 0;
+    bestBlock = uint256();
+    bestHeight = -1;
+
+    Serializer s;
+    s << COINS_MAGIC << COINS_VERSION;
+    FILE* f = fopen(path.c_str(), "wb");
+    bool ok = f && fwrite(s.buffer.data(), 1, s.buffer.size(), f) == s.buffer.size() && SyncFile(f);
+    if (f) ok = (fclose(f) == 0) && ok;
+    if (!ok) {
+        std::cout << "[COINS] Cannot create " << path << std::endl;
+        return false;
+    }
+    fileSize = HEADER_SIZE;
+    return OpenHandles();
+}
+
+bool CoinsDB::Wipe() {
+    return Create();
+}
+
+bool CoinsDB::Open() {
+    CloseHandles();
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) return Create();
+
+    index.clear();
+    mask = 0;
+    count = 0;
+    scriptHeads.clear();
+    staleRecords = 0;
+    bestBlock = uint256();
+    bestHeight = -1;
+
+    MappedFile map;
+    if (!map.Open(path)) {
+        std::cout << "[COINS] Cannot read " << path << std::endl;
+        return false;
+    }
+    uint32_t magic = 0, version = 0;
+    if (map.size() >= HEADER_SIZE) {
+        Deserializer d(map.data(), HEADER_SIZE);
+        d >> magic >> version;
+    }
+    if (magic != COINS_MAGIC || version != COINS_VERSION) {
+        std::cout << "[COINS] " << path << " is not a coin database, starting empty" << std::endl;
+        map.Close();
+        return Create();
+    }
+
+    OutPoint op;
+    uint64_t prev = 0;
+    int64_t value = 0;
+    const uint8_t* script = nullptr;
+    uint64_t scriptLen = 0, batchLen = 0;
+    uint32_t checksum = 0;
+    uint256 hash;
+    int32_t height = -1;
+
+    // Pass 1: find the end of the last batch whose commit record checks out
+    size_t keep = HEADER_SIZE;
+    try {
+        Deserializer d(map.data(), map.size());
+        d.pos = HEADER_SIZE;
+        size_t batchStart = HEADER_SIZE;
+        while (d.remaining() > 0) {
+            size_t offset = d.pos;
+            if (ParseRecord(d, op, prev, value, script, scriptLen, batchLen, checksum, hash, height) != RECORD_COMMIT) continue;
+            if (batchLen != offset - batchStart || BatchChecksum(map.data() + batchStart, batchLen) != checksum) break;
+            keep = d.pos;
+            batchStart = keep;
+        }
+    } catch (const std::exception&) {
+        // torn record: everything from the last good commit on is dropped
+    }
+
+    // Pass 2: apply the committed records
+    window = map.data();
+    windowStart = 0;
+    windowSize = keep;
+    Deserializer d(map.data(), keep);
+    d.pos = HEADER_SIZE;
+    bool indexed = true;
+    while (indexed && d.remaining() > 0) {
+        uint64_t offset = d.pos;
+        uint8_t type = ParseRecord(d, op, prev, value, script, scriptLen, batchLen, checksum, hash, height);
+        if (type == RECORD_PUT) {
+            indexed = IndexPut(op, offset);
+            scriptHeads[ScriptHash(script, scriptLen)] = offset;
+        } else if (type == RECORD_ERASE) {
+            indexed = IndexErase(op);
+        } else {
+            bestBlock = hash;
+            bestHeight = height;
+        }
+    }
+    window = nullptr;
+    windowSize = 0;
+    if (!indexed) {
+        std::cout << "[COINS] Unreadable coin record in " << path << ", cannot build the index" << std::endl;
+        return false;
+    }
+
+    size_t total = map.size();
+    map.Close();
+    if (keep < total) {
+        std::cout << "[COINS] Discarding " << (total - keep) << " bytes of uncommitted coin records" << std::endl;
+        std::filesystem::resize_file(path, keep, ec);
+        if (ec) {
+            std::cout << "[COINS] Cannot truncate " << path << ": " << ec.message() << std::endl;
+            return false;
+        }
+    }
+    fileSize = keep;
+    return OpenHandles();
+}
+
+bool CoinsDB::ReadRecord(uint64_t offset, OutPoint& op, TxOut* out, uint64_t* prev) const {
+    uint64_t unusedPrev;
+    if (!prev) prev = &unusedPrev;
+    try {
+        if (window && offset >= windowStart && offset - windowStart < windowSize) {
+            Deserializer d(window + (offset - windowStart), windowSize - (offset - windowStart));
+            uint8_t type;
+            d >> type;
+            if (type != RECORD_PUT) return false;
+            d.read(op.hash.data.data(), op.hash.data.size());
+            d >> op.n >> *prev;
+            if (out) d >> *out;
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(readMutex);
+        if (!readFile) return false;
+        uint8_t header[PUT_HEADER_SIZE];
+        size_t want = out ? PUT_HEADER_SIZE : 1 + KEY_SIZE + 8;
+        if (fseek(readFile, (long)offset, SEEK_SET) != 0 || fread(header, 1, want, readFile) != want) return false;
+        Deserializer d(header, want);
+        uint8_t type;
+        d >> type;
+        if (type != RECORD_PUT) return false;
+        d.read(op.hash.data.data(), op.hash.data.size());
+        d >> op.n >> *prev;
+        if (out) {
+            uint64_t len;
+            d >> out->value >> len;
+            if (len > fileSize) return false;
+            out->scriptPubKey.resize(len);
+            if (len && fread(out->scriptPubKey.data(), 1, len, readFile) != len) return false;
+        }
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool CoinsDB::FindSlot(const OutPoint& op, uint64_t hash, size_t& slot) const {
+    slot = SIZE_MAX;
+    if (index.empty()) return true;
+    for (size_t i = hash & mask; index[i].offset != 0; i = (i + 1) & mask) {
+        if (index[i].hash != hash) continue;
+        OutPoint key;
+        if (!ReadRecord(index[i].offset, key, nullptr)) return false;
+        if (key == op) {
+            slot = i;
+            return true;
+        }
+    }
+    return true;
+}
+
+bool CoinsDB::MayContain(const OutPoint& op) const {
+    if (index.empty()) return false;
+    uint64_t hash = hasher(op);
+    for (size_t i = hash & mask; index[i].offset != 0; i = (i + 1) & mask) {
+        if (index[i].hash == hash) return true;
+    }
+    return false;
+}
+
+bool CoinsDB::Get(const OutPoint& op, TxOut& out) const {
+    if (index.empty()) return false;
+    uint64_t hash = hasher(op);
+    for (size_t i = hash & mask; index[i].offset != 0; i = (i + 1) & mask) {
+        OutPoint key;
+        if (index[i].hash == hash && ReadRecord(index[i].offset, key, &out) && key == op) return true;
+    }
+    return false;
+}
+
+void CoinsDB::Grow() {
+    size_t capacity = index.empty() ? MIN_INDEX_SIZE : index.size() * 2;
+    std::vector<IndexSlot> old(capacity, IndexSlot{0, 0});
+    old.swap(index);
+    mask = capacity - 1;
+    for (const IndexSlot& slot : old) {
+        if (slot.offset == 0) continue;
+        size_t i = slot.hash & mask;
+        while (index[i].offset != 0) i = (i + 1) & mask;
+        index[i] = slot;
+    }
+}
+
+bool CoinsDB::IndexPut(const OutPoint& op, uint64_t offset) {
+    uint64_t hash = hasher(op);
+    size_t found;
+    if (!FindSlot(op, hash, found)) return false;
+    if (found != SIZE_MAX) {
+        index[found].offset = offset;
+        staleRecords++;
+        return true;
+    }
+    if (count + 1 > index.size() - index.size() / 8) Grow();
+    size_t i = hash & mask;
+    while (index[i].offset != 0) i = (i + 1) & mask;
+    index[i] = {hash, offset};
+    count++;
+    return true;
+}
+
+bool CoinsDB::IndexErase(const OutPoint& op) {
+    size_t i;
+    if (!FindSlot(op, hasher(op), i)) return false;
+    staleRecords++; // the erase record itself
+    if (i == SIZE_MAX) return true;
+    staleRecords++; // and the put it cancels
+    count--;
+
+    // Backward-shift deletion, as in UTXOTable::Erase
+    for (size_t j = i;;) {
+        j = (j + 1) & mask;
+        if (index[j].offset == 0) break;
+        size_t home = index[j].hash & mask;
+        bool staysPut = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (staysPut) continue;
+        index[i] = index[j];
+        i = j;
+    }
+    index[i] = {0, 0};
+    return true;
+}
+
+bool CoinsDB::Commit(const OutPointSet& erased, const UTXOTable& written, const uint256& bestHash, int height) {
+    if (!appendFile) return false;
+
+    Serializer s;
+    for (const OutPoint& op : erased) {
+        s << RECORD_ERASE;
+        s.write(op.hash.data.data(), op.hash.data.size());
+        s << op.n;
+    }
+    // Heads move only once the batch is on disk
+    std::unordered_map<uint64_t, uint64_t> batchHeads;
+    written.ForEach([&](const OutPoint& op, const CoinView& coin) {
+        uint64_t hash = ScriptHash(coin.script, coin.scriptLen);
+        auto head = batchHeads.find(hash);
+        uint64_t prev = head != batchHeads.end() ? head->second : PreviousPut(scriptHeads, hash);
+        batchHeads[hash] = fileSize + s.buffer.size();
+        WritePut(s, op, prev, coin);
+    });
+    size_t batchLen = s.buffer.size();
+    WriteCommit(s, 0, bestHash, height);
+
+    if (fwrite(s.buffer.data(), 1, s.buffer.size(), appendFile) != s.buffer.size() || !SyncFile(appendFile)) {
+        // Cut the partial batch off so later commits still follow a valid one
+        std::cout << "[COINS] Write to " << path << " failed" << std::endl;
+        CloseHandles();
+        std::error_code ec;
+        std::filesystem::resize_file(path, fileSize, ec);
+        OpenHandles();
+        return false;
+    }
+
+    // Index the batch straight from the buffer that was just written
+    window = s.buffer.data();
+    windowStart = fileSize;
+    windowSize = s.buffer.size();
+    Deserializer d(s.buffer.data(), batchLen);
+    OutPoint op;
+    uint64_t prev;
+    int64_t value;
+    const uint8_t* script;
+    uint64_t scriptLen, unusedLen;
+    uint32_t unusedChecksum;
+    uint256 unusedHash;
+    int32_t unusedHeight;
+    bool indexed = true;
+    while (indexed && d.remaining() > 0) {
+        uint64_t offset = fileSize + d.pos;
+        if (ParseRecord(d, op, prev, value, script, scriptLen, unusedLen, unusedChecksum, unusedHash, unusedHeight) == RECORD_PUT) {
+            indexed = IndexPut(op, offset);
+        } else {
+            indexed = IndexErase(op);
+        }
+    }
+    window = nullptr;
+    windowSize = 0;
+    if (!indexed) {
+        // The batch is on disk, but the index is half updated: rebuild it
+        // from the file instead of guessing. The commit stands only if the
+        // file still ends with it.
+        std::cout << "[COINS] Cannot read back a coin record, reloading the index from " << path << std::endl;
+        return Open() && bestHeight == height && bestBlock == bestHash;
+    }
+
+    for (const auto& head : batchHeads) scriptHeads[head.first] = head.second;
+    fileSize += s.buffer.size();
+    bestBlock = bestHash;
+    bestHeight = height;
+
+    if (staleRecords > count && staleRecords >= MIN_COMPACT_RECORDS) Compact();
+    return true;
+}
+
+void CoinsDB::ForEach(const std::function<void(const OutPoint&, const CoinView&)>& fn) const {
+    if (index.empty()) return;
+    MappedFile map;
+    if (!map.Open(path)) return;
+
+    Deserializer d(map.data(), std::min<size_t>(map.size(), fileSize));
+    d.pos = HEADER_SIZE;
+    OutPoint op;
+    uint64_t prev;
+    int64_t value = 0;
+    const uint8_t* script = nullptr;
+    uint64_t scriptLen = 0, batchLen;
+    uint32_t checksum;
+    uint256 hash;
+    int32_t height;
+    try {
+        while (d.remaining() > 0) {
+            uint64_t offset = d.pos;
+            if (ParseRecord(d, op, prev, value, script, scriptLen, batchLen, checksum, hash, height) != RECORD_PUT) continue;
+            if (IsLive(op, offset)) fn(op, CoinView{value, script, (size_t)scriptLen});
+        }
+    } catch (const std::exception&) {
+    }
+}
+
+bool CoinsDB::ForEachWithScript(const std::string& script, const std::function<void(const OutPoint&, const CoinView&)>& fn) const {
+    uint64_t offset = PreviousPut(scriptHeads, ScriptHash((const uint8_t*)script.data(), script.size()));
+    OutPoint op;
+    TxOut out;
+    while (offset != 0) {
+        uint64_t prev;
+        // Links only point back, so a larger one means a damaged record
+        if (!ReadRecord(offset, op, &out, &prev) || prev >= offset) return false;
+        if (out.scriptPubKey.size() == script.size() && memcmp(out.scriptPubKey.data(), script.data(), script.size()) == 0 &&
+            IsLive(op, offset)) {
+            fn(op, CoinView{out.value, out.scriptPubKey.data(), out.scriptPubKey.size()});
+        }
+        offset = prev;
+    }
+    return true;
+}
+
+bool CoinsDB::IsLive(const OutPoint& op, uint64_t offset) const {
+    if (index.empty()) return false;
+    uint64_t hash = hasher(op);
+    for (size_t i = hash & mask; index[i].offset != 0; i = (i + 1) & mask) {
+        if (index[i].offset == offset) return true;
+    }
+    return false;
+}
+
+size_t CoinsDB::MemoryUsage() const {
+    return index.capacity() * sizeof(IndexSlot) + scriptHeads.size() * HEAD_ENTRY_BYTES + scriptHeads.bucket_count() * sizeof(void*);
+}
+
+bool CoinsDB::Compact() {
+    std::cout << "[COINS] Compacting " << path << " (" << count << " coins, " << staleRecords << " stale records)" << std::endl;
+    std::string tmpPath = path + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (!f) return false;
+
+    // Live coins go out in several committed batches so no single buffer
+    // has to hold the whole set
+    Serializer s;
+    s << COINS_MAGIC << COINS_VERSION;
+    size_t batchStart = s.buffer.size();
+    uint64_t flushed = 0; // bytes of the new file already written
+    std::unordered_map<uint64_t, uint64_t> heads;
+    bool ok = true;
+    ForEach([&](const OutPoint& op, const CoinView& coin) {
+        uint64_t hash = ScriptHash(coin.script, coin.scriptLen);
+        uint64_t prev = PreviousPut(heads, hash);
+        heads[hash] = flushed + s.buffer.size();
+        WritePut(s, op, prev, coin);
+        if (s.buffer.size() < COMPACT_BATCH_BYTES) return;
+        WriteCommit(s, batchStart, bestBlock, bestHeight);
+        ok = ok && fwrite(s.buffer.data(), 1, s.buffer.size(), f) == s.buffer.size();
+        flushed += s.buffer.size();
+        s.buffer.clear();
+        batchStart = 0;
+    });
+    WriteCommit(s, batchStart, bestBlock, bestHeight);
+    ok = ok && fwrite(s.buffer.data(), 1, s.buffer.size(), f) == s.buffer.size() && SyncFile(f);
+    ok = (fclose(f) == 0) && ok;
+
+    std::error_code ec;
+    if (ok) {
+        CloseHandles();
+        std::filesystem::rename(tmpPath, path, ec);
+    }
+    if (!ok || ec) {
+        std::cout << "[COINS] Compaction failed" << std::endl;
+        std::filesystem::remove(tmpPath, ec);
+    }
+    // Rebuild the index against whichever file is now in place
+    return Open() && ok;
+}
+
+} // namespace aurelis
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "chain/utxo_table.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace aurelis {
+
+using OutPointSet = std::unordered_set<OutPoint, OutPointHasher>;
+
+// Log-structured on-disk coin store.
+//
+// The file is a header followed by batches of put/erase records, each closed
+// by a commit record carrying the batch length, a checksum and the best
+// block the coins correspond to. Opening replays committed batches and
+// truncates anything after the last valid commit, so a crash mid-flush
+// leaves the previous state. Only a hash -> file offset index (16 bytes a
+// slot) is kept in memory; coin bodies stay on disk. The log is rewritten
+// once stale records outnumber live coins.
+//
+// Each put record also links to the previous put for the same script, and
+// the newest put per script is kept in memory, so the coins paying one
+// address are found without scanning the log.
+class CoinsDB {
+public:
+    explicit CoinsDB(const std::string& path);
+    ~CoinsDB();
+
+    CoinsDB(const CoinsDB&) = delete;
+    CoinsDB& operator=(const CoinsDB&) = delete;
+
+    // Build the index from the log, creating it if missing; false if the
+    // file cannot be used.
+    bool Open();
+    // Drop every coin (reindex, or a best block that left the chain)
+    bool Wipe();
+
+    // Best block of the last commit; Height() is -1 while empty
+    const uint256& BestBlock() const { return bestBlock; }
+    int Height() const { return bestHeight; }
+    size_t Size() const { return count; }
+
+    bool Get(const OutPoint& op, TxOut& out) const;
+    // Cheap in-memory check; may rarely report a coin that is not there
+    bool MayContain(const OutPoint& op) const;
+
+    // Append erasures, then puts, then a commit record for `bestHash`, and
+    // sync. The batch is all-or-nothing across crashes.
+    bool Commit(const OutPointSet& erased, const UTXOTable& written, const uint256& bestHash, int height);
+
+    // Visit every live coin in file order as fn(const OutPoint&, const CoinView&)
+    void ForEach(const std::function<void(const OutPoint&, const CoinView&)>& fn) const;
+    // Visit the live coins paying exactly `script`, newest first. Reads each
+    // put written for the script since the last compaction; false if one
+    // cannot be read back.
+    bool ForEachWithScript(const std::string& script, const std::function<void(const OutPoint&, const CoinView&)>& fn) const;
+
+    // Bytes held by the in-memory index and the script heads
+    size_t MemoryUsage() const;
+
+private:
+    struct IndexSlot {
+        uint64_t hash;
+        uint64_t offset; // 0 marks a free slot (the file header sits there)
+    };
+
+    std::string path;
+    FILE* appendFile;
+    mutable FILE* readFile;
+    mutable std::mutex readMutex; // concurrent Get() calls share readFile's position
+    uint64_t fileSize;
+
+    std::vector<IndexSlot> index; // size is zero or a power of two
+    size_t mask;
+    size_t count;
+    // Script hash -> newest put record for it. Colliding scripts share a
+    // chain; readers compare the script.
+    std::unordered_map<uint64_t, uint64_t> scriptHeads;
+    uint64_t staleRecords; // superseded puts and erase records in the log
+    OutPointHasher hasher;
+
+    uint256 bestBlock;
+    int bestHeight;
+
+    // Bytes of the file currently held in memory (the mapping while
+    // scanning, the pending batch while committing), so key checks can skip
+    // the disk
+    const uint8_t* window;
+    uint64_t windowStart;
+    size_t windowSize;
+
+    bool Create();
+    bool OpenHandles();
+    void CloseHandles();
+    bool Compact();
+    bool ReadRecord(uint64_t offset, OutPoint& op, TxOut* out, uint64_t* prev = nullptr) const;
+    // True if the index still points `op` at the put record at `offset`
+    bool IsLive(const OutPoint& op, uint64_t offset) const;
+    // `slot` is SIZE_MAX if absent. False if a candidate record cannot be
+    // read back, in which case absence is unknown and the index must not
+    // be changed on that basis.
+    bool FindSlot(const OutPoint& op, uint64_t hash, size_t& slot) const;
+    bool IndexPut(const OutPoint& op, uint64_t offset);
+    bool IndexErase(const OutPoint& op);
+    void Grow();
+};
+
+} // namespace aurelis
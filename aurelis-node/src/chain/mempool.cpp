@@ -1,44 +1,392 @@
 #include "chain/mempool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
 #include <iostream>
+#include <unordered_set>
 
 namespace aurelis {
 
-Mempool::Mempool() {}
+namespace {
+// SelectTransactions gives up after this many entries in a row do not fit
+const size_t MAX_CONSECUTIVE_MISSES = 64;
 
-bool Mempool::AddTransaction(const Transaction& tx) {
-    std::lock_guard<std::mutex> lock(mempoolMutex);
-    
-    uint256 hash = tx.GetHash();
-    if (pool.count(hash)) return false;
+const int64_t MIN_FEE_HALFLIFE = 12 * 60 * 60;
 
-    if (!ValidateTransaction(tx)) {
-        return false;
+// Red-black tree node: color, three links, value
+const size_t SET_NODE_BYTES = 4 * sizeof(void*) + sizeof(void*);
+
+// Heap held by a pooled transaction: its pool node (key, entry, link,
+// cached hash), its two index set nodes, the transaction's own vectors and
+// one spentBy node per input
+size_t EstimateEntryMemory(const Transaction& tx) {
+    size_t bytes = sizeof(uint256) + sizeof(MempoolEntry) + 2 * sizeof(void*) + 2 * SET_NODE_BYTES;
+    bytes += tx.vin.capacity() * sizeof(TxIn) + tx.vout.capacity() * sizeof(TxOut);
+    for (const auto& in : tx.vin) bytes += in.scriptSig.capacity();
+    for (const auto& out : tx.vout) bytes += out.scriptPubKey.capacity();
+    bytes += tx.vin.size() * (sizeof(OutPoint) + sizeof(uint256) + 2 * sizeof(void*));
+    return bytes;
+}
+}
+
+Mempool::Mempool(CoinLookup lookup, const MempoolOptions& opts)
+    : nextSequence(0), lookupCoin(std::move(lookup)), options(opts), totalBytes(0), totalUsage(0),
+      rollingMinFeeRate(0), minFeeUpdated(0), evictedCount(0), expiredCount(0), blocksConnected(0), workers(std::max(1, opts.threads)) {}
+
+size_t Mempool::DynamicUsage() const {
+    return totalUsage + (pool.bucket_count() + spentBy.bucket_count()) * sizeof(void*);
+}
+
+double Mempool::MinFeeRate(int64_t now) const {
+    if (rollingMinFeeRate <= 0) return 0;
+    double rate = rollingMinFeeRate * std::pow(0.5, (double)std::max<int64_t>(0, now - minFeeUpdated) / MIN_FEE_HALFLIFE);
+    // Once it has decayed below half an increment, admission is free again
+    return rate < options.incrementalFeeRate / 2 ? 0 : rate;
+}
+
+void Mempool::TrimToSize(int64_t now) {
+    size_t evicted = 0;
+    double maxEvictedRate = -1;
+    while (!byFeeRate.empty() && DynamicUsage() > options.maxBytes) {
+        const MempoolEntry* worst = *byFeeRate.rbegin();
+        maxEvictedRate = std::max(maxEvictedRate, worst->FeeRate());
+        evicted += RemoveWithDescendants(worst->txid);
+    }
+    if (evicted == 0) return;
+    evictedCount += evicted;
+    rollingMinFeeRate = std::max(MinFeeRate(now), maxEvictedRate + options.incrementalFeeRate);
+    minFeeUpdated = now;
+    std::cout << "[MEMPOOL] Full: evicted " << evicted << " transactions, minimum fee rate now "
+              << rollingMinFeeRate << " sat/byte" << std::endl;
+}
+
+void Mempool::Expire(int64_t now) {
+    size_t expired = 0;
+    while (!byTime.empty() && (*byTime.begin())->time + options.expirySeconds < now) {
+        expired += RemoveWithDescendants((*byTime.begin())->txid);
     }
+    if (expired == 0) return;
+    expiredCount += expired;
+    std::cout << "[MEMPOOL] Expired " << expired << " transactions" << std::endl;
+}
+
+bool Mempool::ComputeFee(const Candidate& candidate, int64_t& fee) const {
+    const Transaction& tx = candidate.tx;
+    // The one null-prevout input ValidateTransaction lets through is a
+    // MINT, which creates its outputs and pays no fee
+    if (!lookupCoin || tx.vin[0].prevout_hash == uint256()) {
+        fee = 0;
+        return true;
+    }
+    int64_t in = 0, out = 0;
+    for (const auto& txout : tx.vout) out += txout.value;
+    for (size_t i = 0; i < tx.vin.size(); ++i) {
+        const auto& txin = tx.vin[i];
+        TxOut coin;
+        if (FindUnconfirmed({txin.prevout_hash, txin.prevout_n}, coin)) {
+            in += coin.value;
+        } else if (candidate.confirmed[i]) {
+            in += candidate.coins[i].value;
+        } else {
+            return false;
+        }
+    }
+    fee = in - out;
+    return fee >= 0;
+}
+
+const char* MempoolAcceptReason(MempoolAccept result) {
+    switch (result) {
+    case MempoolAccept::Accepted: return "accepted";
+    case MempoolAccept::Duplicate: return "already in the mempool";
+    case MempoolAccept::Invalid: return "invalid transaction";
+    case MempoolAccept::Conflict: return "input already spent by a mempool transaction";
+    case MempoolAccept::MissingInputs: return "unknown input or outputs exceed inputs";
+    case MempoolAccept::FeeTooLow: return "fee rate below the mempool minimum";
+    case MempoolAccept::Full: return "mempool full";
+    }
+    return "unknown";
+}
+
+void Mempool::Prepare(Transaction&& txIn, Candidate& candidate) {
+    candidate.tx = std::move(txIn);
+    const Transaction& tx = candidate.tx;
+    candidate.hash = tx.GetHash();
+    candidate.valid = ValidateTransaction(tx);
+    if (!candidate.valid) return;
+    Serializer s;
+    s << tx;
+    candidate.size = s.buffer.size();
+    candidate.usage = EstimateEntryMemory(tx);
+}
+
+void Mempool::ResolveInputs(Candidate& candidate) const {
+    const Transaction& tx = candidate.tx;
+    candidate.coins.assign(tx.vin.size(), TxOut());
+    candidate.confirmed.assign(tx.vin.size(), false);
+    if (!candidate.valid || !lookupCoin) return;
+    for (size_t i = 0; i < tx.vin.size(); ++i) {
+        const auto& txin = tx.vin[i];
+        if (txin.prevout_hash == uint256()) continue;
+        // Misses are fine: the input may be a pooled output
+        candidate.confirmed[i] = lookupCoin({txin.prevout_hash, txin.prevout_n}, candidate.coins[i]);
+    }
+}
+
+std::unique_lock<std::mutex> Mempool::ResolveAndLock(std::vector<Candidate>& candidates) {
+    for (;;) {
+        uint64_t seen = blocksConnected.load();
+        workers.ParallelFor(candidates.size(), 32, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) ResolveInputs(candidates[i]);
+        });
+        std::unique_lock<std::mutex> lock(mempoolMutex);
+        // A block whose removals are still to come will evict whatever
+        // spends its inputs; one already handled may have spent or created
+        // coins resolved above, so look them up again
+        if (blocksConnected.load() == seen) return lock;
+    }
+}
+
+MempoolAccept Mempool::Admit(Candidate& candidate, int64_t now, int64_t& fee) {
+    const Transaction& tx = candidate.tx;
+    const uint256& hash = candidate.hash;
+    if (pool.count(hash)) return MempoolAccept::Duplicate;
+    if (!candidate.valid) return MempoolAccept::Invalid;
+
+    for (const auto& in : tx.vin) {
+        if (in.prevout_hash != uint256() && spentBy.count({in.prevout_hash, in.prevout_n})) return MempoolAccept::Conflict;
+    }
+
+    if (!ComputeFee(candidate, fee)) return MempoolAccept::MissingInputs;
+
+    double minRate = MinFeeRate(now);
+    if (minRate > 0 && (double)fee / (double)candidate.size < minRate) return MempoolAccept::FeeTooLow;
+
+    for (const auto& in : tx.vin) {
+        if (in.prevout_hash != uint256()) spentBy[{in.prevout_hash, in.prevout_n}] = hash;
+    }
+    MempoolEntry& entry = pool[hash];
+    entry.tx = std::move(candidate.tx); // keeps the cached txid
+    entry.txid = hash;
+    entry.fee = fee;
+    entry.size = candidate.size;
+    entry.usage = candidate.usage;
+    entry.time = now;
+    entry.sequence = nextSequence++;
+    totalBytes += entry.size;
+    totalUsage += entry.usage;
+    byFeeRate.insert(&entry);
+    byTime.insert(&entry);
+    return MempoolAccept::Accepted;
+}
 
-    pool[hash] = tx;
-    std::cout << "[MEMPOOL] Added Transaction: " << hash.ToString() << " | Total: " << pool.size() << std::endl;
+bool Mempool::AddTransaction(Transaction tx) {
+    std::vector<Candidate> candidates(1);
+    Candidate& candidate = candidates[0];
+    Prepare(std::move(tx), candidate);
+
+    std::unique_lock<std::mutex> lock = ResolveAndLock(candidates);
+    int64_t now = (int64_t)std::time(nullptr);
+    Expire(now);
+
+    int64_t fee = 0;
+    MempoolAccept result = Admit(candidate, now, fee);
+    if (result == MempoolAccept::Accepted) {
+        TrimToSize(now);
+        if (!pool.count(candidate.hash)) result = MempoolAccept::Full;
+    }
+    if (result == MempoolAccept::Duplicate || result == MempoolAccept::Invalid) return false;
+    if (result != MempoolAccept::Accepted) {
+        std::cout << "[MEMPOOL] Rejected " << candidate.hash.ToString() << ": " << MempoolAcceptReason(result) << std::endl;
+        return false;
+    }
+    std::cout << "[MEMPOOL] Added Transaction: " << candidate.hash.ToString() << " | Fee: " << fee << " | Total: " << pool.size() << std::endl;
     return true;
 }
 
+std::vector<MempoolAcceptResult> Mempool::AddTransactions(std::vector<Transaction> txs) {
+    std::vector<Candidate> candidates(txs.size());
+    workers.ParallelFor(txs.size(), 32, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) Prepare(std::move(txs[i]), candidates[i]);
+    });
+
+    std::vector<MempoolAcceptResult> results(txs.size());
+    size_t accepted = 0, poolSize;
+    {
+        std::unique_lock<std::mutex> lock = ResolveAndLock(candidates);
+        int64_t now = (int64_t)std::time(nullptr);
+        Expire(now);
+        for (size_t i = 0; i < txs.size(); ++i) {
+            int64_t fee = 0;
+            results[i].txid = candidates[i].hash;
+            results[i].result = Admit(candidates[i], now, fee);
+        }
+        TrimToSize(now);
+        for (size_t i = 0; i < txs.size(); ++i) {
+            if (results[i].result != MempoolAccept::Accepted) continue;
+            if (pool.count(results[i].txid)) {
+                accepted++;
+            } else {
+                results[i].result = MempoolAccept::Full;
+            }
+        }
+        poolSize = pool.size();
+    }
+    std::cout << "[MEMPOOL] Batch: accepted " << accepted << " of " << txs.size() << " transactions | Total: " << poolSize << "\n";
+    return results;
+}
+
 std::vector<Transaction> Mempool::GetTransactions() const {
     std::lock_guard<std::mutex> lock(mempoolMutex);
     std::vector<Transaction> txs;
-    for (const auto& pair : pool) {
-        txs.push_back(pair.second);
+    txs.reserve(byTime.size());
+    for (const MempoolEntry* entry : byTime) {
+        txs.push_back(entry->tx);
     }
     return txs;
 }
 
-void Mempool::RemoveTransactions(const std::vector<Transaction>& txs) {
+std::vector<Transaction> Mempool::SelectTransactions(size_t maxBytes) const {
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+    std::vector<Transaction> txs;
+    std::unordered_set<uint256, Uint256Hasher> taken;
+    // Children reached before a pooled parent was taken, by that parent
+    std::unordered_multimap<uint256, const MempoolEntry*, Uint256Hasher> waiting;
+    size_t used = 0;
+    size_t misses = 0;
+
+    // First pooled parent of `entry` not yet in the template, or null
+    auto missingParent = [&](const MempoolEntry* entry) -> const uint256* {
+        for (const auto& in : entry->tx.vin) {
+            if (pool.count(in.prevout_hash) && !taken.count(in.prevout_hash)) return &in.prevout_hash;
+        }
+        return nullptr;
+    };
+
+    for (const MempoolEntry* candidate : byFeeRate) {
+        if (maxBytes - used < candidate->size) {
+            // A run of misfits means the template is as good as full
+            if (++misses >= MAX_CONSECUTIVE_MISSES) break;
+            continue;
+        }
+        misses = 0;
+        if (const uint256* parent = missingParent(candidate)) {
+            waiting.emplace(*parent, candidate);
+            continue;
+        }
+
+        // Take it, then any waiting children it unblocks
+        std::vector<const MempoolEntry*> ready{candidate};
+        while (!ready.empty()) {
+            const MempoolEntry* entry = ready.back();
+            ready.pop_back();
+            if (maxBytes - used < entry->size) continue;
+            const uint256& txid = entry->txid;
+            txs.push_back(entry->tx);
+            taken.insert(txid);
+            used += entry->size;
+            auto range = waiting.equal_range(txid);
+            std::vector<const MempoolEntry*> children;
+            for (auto it = range.first; it != range.second; ++it) children.push_back(it->second);
+            waiting.erase(range.first, range.second);
+            for (const MempoolEntry* child : children) {
+                if (const uint256* parent = missingParent(child)) {
+                    waiting.emplace(*parent, child);
+                } else {
+                    ready.push_back(child);
+                }
+            }
+        }
+        if (maxBytes - used == 0) break;
+    }
+    return txs;
+}
+
+bool Mempool::FindUnconfirmed(const OutPoint& op, TxOut& out) const {
+    auto it = pool.find(op.hash);
+    if (it == pool.end() || op.n >= it->second.tx.vout.size()) return false;
+    out = it->second.tx.vout[op.n];
+    return true;
+}
+
+void Mempool::RemoveEntry(std::unordered_map<uint256, MempoolEntry, Uint256Hasher>::iterator it) {
+    for (const auto& in : it->second.tx.vin) {
+        auto spent = spentBy.find({in.prevout_hash, in.prevout_n});
+        if (spent != spentBy.end() && spent->second == it->first) spentBy.erase(spent);
+    }
+    byFeeRate.erase(&it->second);
+    byTime.erase(&it->second);
+    totalBytes -= it->second.size;
+    totalUsage -= it->second.usage;
+    pool.erase(it);
+}
+
+size_t Mempool::RemoveWithDescendants(const uint256& txid) {
+    size_t removed = 0;
+    std::vector<uint256> stack{txid};
+    while (!stack.empty()) {
+        auto it = pool.find(stack.back());
+        stack.pop_back();
+        if (it == pool.end()) continue;
+        for (uint32_t n = 0; n < it->second.tx.vout.size(); ++n) {
+            auto child = spentBy.find({it->first, n});
+            if (child != spentBy.end()) stack.push_back(child->second);
+        }
+        RemoveEntry(it);
+        removed++;
+    }
+    return removed;
+}
+
+void Mempool::RemoveForBlock(const std::vector<uint256>& txids, const std::vector<OutPoint>& spent) {
     std::lock_guard<std::mutex> lock(mempoolMutex);
-    for (const auto& tx : txs) {
-        pool.erase(tx.GetHash());
+    blocksConnected++;
+    // Runs once per connected block, so stale entries go even without new traffic
+    Expire((int64_t)std::time(nullptr));
+    size_t removed = 0, conflicts = 0;
+    for (const auto& txid : txids) {
+        auto it = pool.find(txid);
+        if (it == pool.end()) continue;
+        // Confirmed: its pooled children stay valid
+        RemoveEntry(it);
+        removed++;
     }
-    if (!txs.empty()) {
-        std::cout << "[MEMPOOL] Removed " << txs.size() << " transactions. Remaining: " << pool.size() << std::endl;
+    // Confirmed entries released their outpoints above, so any spender
+    // left is a conflict
+    for (const auto& op : spent) {
+        auto spender = spentBy.find(op);
+        if (spender != spentBy.end()) conflicts += RemoveWithDescendants(spender->second);
+    }
+    if (removed > 0 || conflicts > 0) {
+        std::cout << "[MEMPOOL] Removed " << removed << " transactions";
+        if (conflicts > 0) std::cout << " and " << conflicts << " conflicting";
+        std::cout << ". Remaining: " << pool.size() << std::endl;
     }
 }
 
+MempoolStats Mempool::GetStats() const {
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+    MempoolStats stats;
+    stats.count = pool.size();
+    stats.bytes = totalBytes;
+    stats.usage = DynamicUsage();
+    stats.maxBytes = options.maxBytes;
+    stats.minFeeRate = MinFeeRate((int64_t)std::time(nullptr));
+    stats.evicted = evictedCount;
+    stats.expired = expiredCount;
+    return stats;
+}
+
+bool Mempool::IsSpent(const OutPoint& op) const {
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+    return spentBy.count(op) > 0;
+}
+
+bool Mempool::GetUnconfirmedOutput(const OutPoint& op, TxOut& out) const {
+    std::lock_guard<std::mutex> lock(mempoolMutex);
+    return FindUnconfirmed(op, out);
+}
+
 size_t Mempool::Size() const {
     std::lock_guard<std::mutex> lock(mempoolMutex);
     return pool.size();
@@ -51,7 +399,7 @@ bool Mempool::Contains(const uint256& hash) const {
 
 bool Mempool::ValidateTransaction(const Transaction& tx) {
     // 1. Basic structural checks
-    if (tx.vout.empty()) return false;
+    if (tx.vin.empty() || tx.vout.empty()) return false;
     
     // 2. Check for negative or zero outputs
     for (const auto& out : tx.vout) {
@@ -70,6 +418,13 @@ bool Mempool::ValidateTransaction(const Transaction& tx) {
     if (!isMint && tx.vin.size() == 1 && tx.vin[0].prevout_hash == uint256()) {
         return false; 
     }
+    // Only that single-input MINT may carry a null prevout; one among
+    // other inputs would be priced at nothing
+    if (tx.vin.size() > 1) {
+        for (const auto& in : tx.vin) {
+            if (in.prevout_hash == uint256()) return false;
+        }
+    }
 
     return true;
 }
@@ -1,33 +1,197 @@
 #pragma once
 
 #include "chain/tx.hpp"
-#include <map>
+#include "chain/utxo_table.hpp"
+#include "util/worker_pool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_map>
 #include <vector>
 #include <mutex>
 
 namespace aurelis {
 
+// Resolves a confirmed coin; used to price transaction inputs. Called
+// without the pool lock, so it may take the chain lock.
+using CoinLookup = std::function<bool(const OutPoint&, TxOut&)>;
+
+struct MempoolOptions {
+    size_t maxBytes = 300 * 1024 * 1024;    // -maxmempool (MB): memory cap, indexes included
+    int64_t expirySeconds = 336 * 60 * 60;  // -mempoolexpiry (hours)
+    double incrementalFeeRate = 1.0;        // sat/byte the minimum fee is raised past an evicted entry
+    int threads = 1;                        // AddTransactions workers for context-free checks
+};
+
+// Outcome of offering one transaction to the pool
+enum class MempoolAccept {
+    Accepted,
+    Duplicate,      // already pooled
+    Invalid,        // fails the context-free checks
+    Conflict,       // an input is spent by a pooled transaction
+    MissingInputs,  // an input cannot be resolved, or outputs exceed inputs
+    FeeTooLow,      // below the rolling minimum fee rate
+    Full,           // evicted again to stay within the memory cap
+};
+
+const char* MempoolAcceptReason(MempoolAccept result);
+
+struct MempoolAcceptResult {
+    uint256 txid;
+    MempoolAccept result = MempoolAccept::Invalid;
+};
+
+struct MempoolStats {
+    size_t count = 0;
+    size_t bytes = 0;        // serialized transactions
+    size_t usage = 0;        // estimated memory, indexes included
+    size_t maxBytes = 0;
+    double minFeeRate = 0;   // sat/byte needed for admission right now
+    uint64_t evicted = 0;    // since startup
+    uint64_t expired = 0;
+};
+
+struct MempoolEntry {
+    Transaction tx;
+    uint256 txid;        // the pool key, so index walks never rehash
+    int64_t fee = 0;     // inputs minus outputs, in satoshi
+    size_t size = 0;     // serialized bytes
+    size_t usage = 0;    // estimated memory of the entry and its index nodes
+    int64_t time = 0;    // admission time (unix seconds)
+    uint64_t sequence = 0; // admission order
+
+    double FeeRate() const { return size ? (double)fee / (double)size : 0.0; }
+};
+
+// Transaction pool indexed three ways: by txid, by fee rate (best first,
+// older first among equals) and by admission order. Each entry caches its
+// fee and serialized size, so building a block template walks the fee-rate
+// index and copies only what it takes.
+//
+// A fourth map records which pooled transaction spends each outpoint, so a
+// conflicting transaction is turned away in O(inputs) and transactions may
+// spend the outputs of other pooled (unconfirmed) ones.
+//
+// Memory is capped at options.maxBytes: past it the lowest fee-rate entries
+// are evicted (with their descendants) and the minimum admission fee rate
+// rises above the evicted rate, decaying back with a 12-hour half-life.
+// Entries older than options.expirySeconds are dropped.
 class Mempool {
 public:
-    Mempool();
-    
-    // Returns true if transaction was added
-    bool AddTransaction(const Transaction& tx);
-    
-    // Get all transactions in the pool
+    // Without a lookup, inputs are not priced and every fee is zero
+    explicit Mempool(CoinLookup lookup = nullptr, const MempoolOptions& options = MempoolOptions());
+
+    // Returns true if transaction was added. Rejected if an input is
+    // already spent by a pooled transaction, cannot be resolved (confirmed
+    // or pooled), the outputs exceed the inputs, its fee rate is below the
+    // current minimum or the pool is full of better-paying transactions.
+    // Taken by value so the entry keeps the transaction (and its cached
+    // txid) without a copy; pass an rvalue where the caller is done with it.
+    bool AddTransaction(Transaction tx);
+
+    // Admit a batch: hashing, the context-free checks and sizing run on the
+    // worker pool without the pool lock, then every survivor is admitted in
+    // one critical section and the cap is enforced once. Transactions may
+    // spend outputs of earlier ones in the same batch. Logs one summary line
+    // instead of one per transaction. Results carry the txids computed on
+    // the way, in input order.
+    std::vector<MempoolAcceptResult> AddTransactions(std::vector<Transaction> txs);
+
+    // Get all transactions in the pool, oldest first
     std::vector<Transaction> GetTransactions() const;
-    
-    // Remove transactions (e.g. after they are included in a block)
-    void RemoveTransactions(const std::vector<Transaction>& txs);
-    
+
+    // Highest fee rate first while they fit in `maxBytes`; a transaction
+    // too large for the space left is skipped, until a run of them shows
+    // the budget is used up. A transaction is only placed after the pooled
+    // transactions it spends from.
+    std::vector<Transaction> SelectTransactions(size_t maxBytes) const;
+
+    // A block confirmed `txids` and spent `spent`: drop the confirmed
+    // entries (their pooled children stay valid), then any pooled
+    // transaction still spending one of those outpoints and everything
+    // built on it. Nothing is hashed; both lists come from block validation.
+    void RemoveForBlock(const std::vector<uint256>& txids, const std::vector<OutPoint>& spent);
+
+    // True if a pooled transaction spends `op`
+    bool IsSpent(const OutPoint& op) const;
+    // Output `op` of a pooled transaction
+    bool GetUnconfirmedOutput(const OutPoint& op, TxOut& out) const;
+
     size_t Size() const;
     bool Contains(const uint256& hash) const;
+    MempoolStats GetStats() const;
 
 private:
-    std::map<uint256, Transaction> pool;
+    struct ByFeeRate {
+        bool operator()(const MempoolEntry* a, const MempoolEntry* b) const {
+            double ra = a->FeeRate(), rb = b->FeeRate();
+            if (ra != rb) return ra > rb;
+            return a->sequence < b->sequence;
+        }
+    };
+    struct BySequence {
+        bool operator()(const MempoolEntry* a, const MempoolEntry* b) const { return a->sequence < b->sequence; }
+    };
+
+    // Lock-free admission work for one transaction; owns it until Admit
+    // moves it into the pool
+    struct Candidate {
+        Transaction tx;
+        uint256 hash;
+        bool valid = false;
+        size_t size = 0;
+        size_t usage = 0;
+        // Confirmed coins per input, looked up before the pool lock is taken
+        std::vector<TxOut> coins;
+        std::vector<bool> confirmed;
+    };
+
+    // Entries are owned here; node-based, so the index pointers stay valid
+    std::unordered_map<uint256, MempoolEntry, Uint256Hasher> pool;
+    std::set<const MempoolEntry*, ByFeeRate> byFeeRate;
+    std::set<const MempoolEntry*, BySequence> byTime;
+    std::unordered_map<OutPoint, uint256, OutPointHasher> spentBy; // outpoint -> pooled spender
+    uint64_t nextSequence;
+    CoinLookup lookupCoin;
+    MempoolOptions options;
+
+    size_t totalBytes;
+    size_t totalUsage; // entry estimates; bucket arrays are added by DynamicUsage()
+    double rollingMinFeeRate;
+    int64_t minFeeUpdated;
+    uint64_t evictedCount;
+    uint64_t expiredCount;
+    // Bumped by RemoveForBlock, so admission can tell its confirmed coins
+    // were looked up before a block it has not seen the removals of
+    std::atomic<uint64_t> blocksConnected;
     mutable std::mutex mempoolMutex;
+    WorkerPool workers;
+
+    static bool ValidateTransaction(const Transaction& tx);
+    static void Prepare(Transaction&& tx, Candidate& candidate);
+    void ResolveInputs(Candidate& candidate) const;
+    // Resolve the candidates' confirmed inputs, then take mempoolMutex; the
+    // pool never waits on the chain lock while holding its own
+    std::unique_lock<std::mutex> ResolveAndLock(std::vector<Candidate>& candidates);
+    // Admission checks and insertion, without trimming. Callers hold
+    // mempoolMutex.
+    MempoolAccept Admit(Candidate& candidate, int64_t now, int64_t& fee);
+    // Sum of the input values minus the outputs; false if an input is unknown
+    bool ComputeFee(const Candidate& candidate, int64_t& fee) const;
+    bool FindUnconfirmed(const OutPoint& op, TxOut& out) const;
+    // Drop an entry and, recursively, the pooled transactions spending it;
+    // returns how many were removed
+    size_t RemoveWithDescendants(const uint256& txid);
+    void RemoveEntry(std::unordered_map<uint256, MempoolEntry, Uint256Hasher>::iterator it);
 
-    bool ValidateTransaction(const Transaction& tx);
+    size_t DynamicUsage() const;
+    // Minimum fee rate at `now`, after decay
+    double MinFeeRate(int64_t now) const;
+    // Evict the lowest fee-rate entries until DynamicUsage() fits
+    void TrimToSize(int64_t now);
+    // Drop entries admitted before now - expirySeconds
+    void Expire(int64_t now);
 };
 
 } // namespace aurelis
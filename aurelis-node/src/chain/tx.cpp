@@ -1,17 +1,17 @@
 #include "chain/block.hpp"
 #include "chain/tx.hpp"
-#include "util/sha256.hpp"
-// Need SHA256 implementation
-// For now returning dummy hash
+#include "util/hash_writer.hpp"
 #include <iostream>
 
 namespace aurelis {
 
 uint256 Transaction::GetHash() const {
-    Serializer s;
-    s << *this;
     uint256 hash;
-    Hash256(s.buffer.data(), s.buffer.size(), hash.data.data());
+    if (hashCache.Get(hash)) return hash;
+    HashWriter hw;
+    hw << *this;
+    hash = hw.GetHash();
+    hashCache.Set(hash);
     return hash;
 }
 
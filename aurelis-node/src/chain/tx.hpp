@@ -15,7 +15,8 @@ public:
 
     TxIn() : prevout_n(0), sequence(0xFFFFFFFF) {}
 
-    void Serialize(Serializer& s) const {
+    template<typename Stream>
+    void Serialize(Stream& s) const {
         s.write(prevout_hash.data.data(), prevout_hash.data.size());
         s << prevout_n;
         s << scriptSig; 
@@ -38,7 +39,8 @@ public:
     TxOut() : value(-1) {}
     TxOut(int64_t val, const std::vector<uint8_t>& script) : value(val), scriptPubKey(script) {}
 
-    void Serialize(Serializer& s) const {
+    template<typename Stream>
+    void Serialize(Stream& s) const {
         s << value;
         s << scriptPubKey;
     }
@@ -58,7 +60,8 @@ public:
 
     Transaction() : version(1), lockTime(0) {}
 
-    void Serialize(Serializer& s) const {
+    template<typename Stream>
+    void Serialize(Stream& s) const {
         s << version;
         s << vin;
         s << vout;
@@ -70,10 +73,15 @@ public:
         d >> vin;
         d >> vout;
         d >> lockTime;
+        hashCache.Reset();
     }
     
-    // Todo: Compute Hash
+    // txid, computed on first use and cached (see CachedHash)
     uint256 GetHash() const;
+    void InvalidateHash() const { hashCache.Reset(); }
+
+private:
+    CachedHash hashCache;
 };
 
 } // namespace aurelis
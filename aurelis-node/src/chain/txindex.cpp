@@ -0,0 +1,86 @@
+#include "chain/txindex.hpp"
+#include "util/mapped_file.hpp"
+#include "util/serialize.hpp"
+#include <filesystem>
+#include <iostream>
+
+namespace aurelis {
+
+namespace {
+const size_t TXINDEX_RECORD_SIZE = 32 + 4 + 4;
+}
+
+TxIndex::TxIndex(const std::string& p) : path(p), file(nullptr), bestHeight(-1) {}
+
+TxIndex::~TxIndex() {
+    if (file) fclose(file);
+}
+
+int TxIndex::Open(int tipHeight) {
+    if (file) fclose(file);
+    file = nullptr;
+    locations.clear();
+    bestHeight = -1;
+
+    // Records are appended block by block, so heights never decrease. Keep
+    // whole blocks up to the tip, minus the last one, which a crash may
+    // have cut short and is simply indexed again.
+    size_t keepBytes = 0;
+    {
+        MappedFile map;
+        if (map.Open(path)) {
+            size_t records = map.size() / TXINDEX_RECORD_SIZE;
+            int lastHeight = -1;
+            for (size_t i = 0; i < records; ++i) {
+                Deserializer d(map.data() + i * TXINDEX_RECORD_SIZE + 32, 4);
+                int32_t height;
+                d >> height;
+                if (height > tipHeight || height < lastHeight) break;
+                if (height != lastHeight) {
+                    keepBytes = i * TXINDEX_RECORD_SIZE;
+                    bestHeight = lastHeight;
+                    lastHeight = height;
+                }
+            }
+
+            Deserializer d(map.data(), keepBytes);
+            while (d.remaining() > 0) {
+                uint256 txid;
+                int32_t height;
+                uint32_t index;
+                d.read(txid.data.data(), txid.data.size());
+                d >> height >> index;
+                locations[txid] = TxLocation(height, index);
+            }
+        }
+    }
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) std::filesystem::resize_file(path, keepBytes, ec);
+    file = fopen(path.c_str(), "ab");
+    if (!file) std::cout << "[TXINDEX] Cannot open " << path << " for writing" << std::endl;
+    return bestHeight;
+}
+
+void TxIndex::AddBlock(const Block& block, int height) {
+    Serializer s;
+    for (uint32_t i = 0; i < block.vtx.size(); ++i) {
+        uint256 txid = block.vtx[i].GetHash();
+        locations[txid] = TxLocation(height, i);
+        s.write(txid.data.data(), txid.data.size());
+        s << (int32_t)height << i;
+    }
+    bestHeight = height;
+    if (file && (fwrite(s.buffer.data(), 1, s.buffer.size(), file) != s.buffer.size() || fflush(file) != 0)) {
+        std::cout << "[TXINDEX] Write failed at height " << height << std::endl;
+    }
+}
+
+bool TxIndex::Find(const uint256& txid, TxLocation& loc) const {
+    auto it = locations.find(txid);
+    if (it == locations.end()) return false;
+    loc = it->second;
+    return true;
+}
+
+} // namespace aurelis
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "chain/block.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+namespace aurelis {
+
+// Where a confirmed transaction lives: block height and position in vtx.
+struct TxLocation {
+    int32_t height;
+    uint32_t index;
+
+    TxLocation() : height(-1), index(0) {}
+    TxLocation(int32_t h, uint32_t i) : height(h), index(i) {}
+};
+
+// Optional txid -> block position index (-txindex).
+//
+// Kept in memory and mirrored to an append-only file of
+// (txid, height, index) records, one batch per connected block, so a restart
+// only has to index the blocks connected since the last run. A txid seen in
+// several blocks resolves to the newest one. Not thread-safe: BlockChain
+// calls it under chainMutex.
+class TxIndex {
+public:
+    explicit TxIndex(const std::string& path);
+    ~TxIndex();
+
+    TxIndex(const TxIndex&) = delete;
+    TxIndex& operator=(const TxIndex&) = delete;
+
+    // Load the file, discarding records above tipHeight and the possibly
+    // incomplete last block. Returns the height indexed up to (-1 if none).
+    // Calling it again rewinds the index to tipHeight.
+    int Open(int tipHeight);
+
+    // Index every transaction of the block connected at `height`.
+    void AddBlock(const Block& block, int height);
+
+    bool Find(const uint256& txid, TxLocation& loc) const;
+    int Height() const { return bestHeight; }
+    size_t Size() const { return locations.size(); }
+
+private:
+    std::string path;
+    FILE* file;
+    int bestHeight;
+    std::unordered_map<uint256, TxLocation, Uint256Hasher> locations;
+};
+
+} // namespace aurelis
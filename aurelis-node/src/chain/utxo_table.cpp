@@ -0,0 +1,179 @@
+#include "chain/utxo_table.hpp"
+#include <cstring>
+#include <random>
+
+namespace aurelis {
+
+namespace {
+const size_t MIN_CAPACITY = 16;
+
+// splitmix64 finalizer
+uint64_t Mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+}
+
+OutPointHasher::OutPointHasher() {
+    std::random_device rd;
+    salt0 = ((uint64_t)rd() << 32) | rd();
+    salt1 = ((uint64_t)rd() << 32) | rd();
+}
+
+uint64_t OutPointHasher::Hash(const uint256& txid, uint32_t n) const {
+    uint64_t h = salt0 ^ n;
+    for (size_t i = 0; i < uint256::WIDTH; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, txid.data.data() + i, sizeof(word));
+        h = Mix(h ^ word);
+    }
+    return Mix(h ^ salt1);
+}
+
+UTXOTable::UTXOTable() : mask(0), count(0), poolBytes(0) {}
+
+void UTXOTable::Clear() {
+    slots.clear();
+    slots.shrink_to_fit();
+    mask = 0;
+    count = 0;
+    pool.clear();
+    freeIds.clear();
+    poolIds.clear();
+    poolBytes = 0;
+}
+
+void UTXOTable::Reserve(size_t coins) {
+    // Keep the load factor at or below 7/8
+    size_t capacity = MIN_CAPACITY;
+    while (capacity - capacity / 8 < coins) capacity *= 2;
+    if (capacity > slots.size()) Rehash(capacity);
+}
+
+void UTXOTable::Rehash(size_t capacity) {
+    std::vector<Slot> old(capacity);
+    old.swap(slots);
+    for (Slot& slot : slots) slot.scriptLen = EMPTY;
+    mask = capacity - 1;
+    for (const Slot& slot : old) {
+        if (slot.scriptLen == EMPTY) continue;
+        size_t i = hasher.Hash(slot.txid, slot.n) & mask;
+        while (slots[i].scriptLen != EMPTY) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+size_t UTXOTable::Locate(const OutPoint& op, uint64_t hash) const {
+    if (slots.empty()) return SIZE_MAX;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.scriptLen == EMPTY) return SIZE_MAX;
+        if (slot.n == op.n && slot.txid == op.hash) return i;
+    }
+}
+
+CoinView UTXOTable::View(const Slot& slot) const {
+    const uint8_t* script = slot.scriptLen <= INLINE_SCRIPT
+        ? slot.script.bytes
+        : (const uint8_t*)pool[slot.script.poolId].bytes.data();
+    return {slot.value, script, slot.scriptLen};
+}
+
+bool UTXOTable::Find(const OutPoint& op, CoinView& coin) const {
+    size_t i = Locate(op, hasher.Hash(op.hash, op.n));
+    if (i == SIZE_MAX) return false;
+    coin = View(slots[i]);
+    return true;
+}
+
+uint32_t UTXOTable::AcquireScript(const std::vector<uint8_t>& script) {
+    std::string_view key((const char*)script.data(), script.size());
+    auto it = poolIds.find(key);
+    if (it != poolIds.end()) {
+        pool[it->second].refs++;
+        return it->second;
+    }
+    uint32_t id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = (uint32_t)pool.size();
+        pool.emplace_back();
+    }
+    PooledScript& entry = pool[id];
+    entry.bytes.assign(key);
+    entry.refs = 1;
+    // Long scripts are always heap-allocated, so this view survives pool growth
+    poolIds.emplace(std::string_view(entry.bytes), id);
+    poolBytes += entry.bytes.capacity();
+    return id;
+}
+
+void UTXOTable::ReleaseScript(const Slot& slot) {
+    if (slot.scriptLen <= INLINE_SCRIPT) return;
+    uint32_t id = slot.script.poolId;
+    PooledScript& entry = pool[id];
+    if (--entry.refs > 0) return;
+    poolIds.erase(std::string_view(entry.bytes));
+    poolBytes -= entry.bytes.capacity();
+    std::string().swap(entry.bytes);
+    freeIds.push_back(id);
+}
+
+void UTXOTable::Insert(const OutPoint& op, const TxOut& out) {
+    uint64_t hash = hasher.Hash(op.hash, op.n);
+    size_t i = Locate(op, hash);
+    if (i != SIZE_MAX) {
+        // Replacing a coin leaves the count unchanged, so never grow here
+        ReleaseScript(slots[i]);
+    } else {
+        if (count + 1 > slots.size() - slots.size() / 8) {
+            Rehash(slots.empty() ? MIN_CAPACITY : slots.size() * 2);
+        }
+        i = hash & mask;
+        while (slots[i].scriptLen != EMPTY) i = (i + 1) & mask;
+        count++;
+    }
+    Slot& slot = slots[i];
+    slot.txid = op.hash;
+    slot.n = op.n;
+    slot.value = out.value;
+    slot.scriptLen = (uint32_t)out.scriptPubKey.size();
+    if (slot.scriptLen <= INLINE_SCRIPT) {
+        memset(slot.script.bytes, 0, INLINE_SCRIPT);
+        if (slot.scriptLen) memcpy(slot.script.bytes, out.scriptPubKey.data(), slot.scriptLen);
+    } else {
+        slot.script.poolId = AcquireScript(out.scriptPubKey);
+    }
+}
+
+bool UTXOTable::Erase(const OutPoint& op) {
+    size_t i = Locate(op, hasher.Hash(op.hash, op.n));
+    if (i == SIZE_MAX) return false;
+    ReleaseScript(slots[i]);
+    count--;
+
+    // Backward-shift deletion: pull later members of the cluster into the
+    // hole unless that would move them before their home slot
+    for (size_t j = i;;) {
+        j = (j + 1) & mask;
+        if (slots[j].scriptLen == EMPTY) break;
+        size_t home = hasher.Hash(slots[j].txid, slots[j].n) & mask;
+        bool staysPut = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (staysPut) continue;
+        slots[i] = slots[j];
+        i = j;
+    }
+    slots[i].scriptLen = EMPTY;
+    return true;
+}
+
+size_t UTXOTable::MemoryUsage() const {
+    return slots.capacity() * sizeof(Slot) + pool.size() * sizeof(PooledScript) + poolBytes;
+}
+
+} // namespace aurelis
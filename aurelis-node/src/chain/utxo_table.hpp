@@ -0,0 +1,118 @@
+#pragma once
+
+#include "chain/tx.hpp"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace aurelis {
+
+struct OutPoint {
+    uint256 hash;
+    uint32_t n;
+    bool operator<(const OutPoint& other) const {
+        if (hash != other.hash) return hash.data < other.hash.data;
+        return n < other.n;
+    }
+    bool operator==(const OutPoint& other) const { return n == other.n && hash == other.hash; }
+};
+
+// Salted 64-bit outpoint hash. The salt is random per instance, so crafted
+// txids cannot force long probe chains in the tables keyed by it.
+class OutPointHasher {
+public:
+    OutPointHasher();
+    uint64_t Hash(const uint256& txid, uint32_t n) const;
+    uint64_t operator()(const OutPoint& op) const { return Hash(op.hash, op.n); }
+
+private:
+    uint64_t salt0, salt1;
+};
+
+// Read-only view of a stored coin. The script pointer stays valid until the
+// table is next modified.
+struct CoinView {
+    int64_t value;
+    const uint8_t* script;
+    size_t scriptLen;
+
+    TxOut ToTxOut() const { return TxOut(value, std::vector<uint8_t>(script, script + scriptLen)); }
+};
+
+// Unspent output set.
+//
+// Open addressing with linear probing over a flat array of 64-byte slots,
+// keyed by OutPointHasher. Scripts of up to INLINE_SCRIPT bytes live in the
+// slot itself; longer ones are interned in a shared pool, so every coin
+// paying the same script costs one reference.
+// Erase shifts the following cluster back instead of leaving tombstones.
+class UTXOTable {
+public:
+    static constexpr size_t INLINE_SCRIPT = 16;
+
+    UTXOTable();
+
+    size_t Size() const { return count; }
+    void Clear();
+    void Reserve(size_t coins);
+
+    bool Find(const OutPoint& op, CoinView& coin) const;
+    // Insert, replacing any coin already stored at `op`
+    void Insert(const OutPoint& op, const TxOut& out);
+    bool Erase(const OutPoint& op);
+
+    // Visit every coin in table order as fn(const OutPoint&, const CoinView&)
+    template <typename Fn>
+    void ForEach(Fn&& fn) const {
+        for (const Slot& slot : slots) {
+            if (slot.scriptLen == EMPTY) continue;
+            OutPoint op{slot.txid, slot.n};
+            fn(op, View(slot));
+        }
+    }
+
+    // Bytes held by the slot array and the script pool
+    size_t MemoryUsage() const;
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+    struct Slot {
+        uint256 txid;
+        uint32_t n;
+        uint32_t scriptLen; // EMPTY marks a free slot
+        int64_t value;
+        union {
+            uint8_t bytes[INLINE_SCRIPT];
+            uint32_t poolId; // scriptLen > INLINE_SCRIPT
+        } script;
+    };
+    static_assert(sizeof(Slot) == 64, "UTXO slots should fill one cache line");
+
+    struct PooledScript {
+        std::string bytes;
+        uint32_t refs;
+    };
+
+    std::vector<Slot> slots; // size is zero or a power of two
+    size_t mask;
+    size_t count;
+    OutPointHasher hasher;
+
+    // Interned long scripts; ids of released entries are reused
+    std::deque<PooledScript> pool;
+    std::vector<uint32_t> freeIds;
+    std::unordered_map<std::string_view, uint32_t> poolIds;
+    size_t poolBytes;
+
+    size_t Locate(const OutPoint& op, uint64_t hash) const; // slot index or SIZE_MAX
+    void Rehash(size_t capacity);
+    CoinView View(const Slot& slot) const;
+    uint32_t AcquireScript(const std::vector<uint8_t>& script);
+    void ReleaseScript(const Slot& slot);
+};
+
+} // namespace aurelis
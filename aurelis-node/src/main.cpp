@@ -4,16 +4,28 @@
 #include <thread>
 #include <chrono>
 #include <ctime>
+#include <algorithm>
 #include "chain/block.hpp"
 #include "chain/genesis.hpp"
 #include "util/serialize.hpp"
+#include "util/sha256.hpp"
 #include "rpc/rpc_server.hpp"
 #include "miner/miner.hpp"
 #include "util/address.hpp"
+#include "util/args.hpp"
 #include "chain/blockchain.hpp"
 #include "chain/mempool.hpp"
 #include "net/p2p_server.hpp"
 #include <exception>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+
+static std::atomic<bool> g_shutdownRequested(false);
+
+static void HandleShutdownSignal(int) {
+    g_shutdownRequested = true;
+}
 
 void print_banner() {
     std::cout << "============================================" << std::endl;
@@ -24,11 +36,12 @@ void print_banner() {
 
 int main(int argc, char* argv[]) {
     try {
-        (void)argc;
-    (void)argv;
+    aurelis::ArgsManager args;
+    args.Parse(argc, argv);
     print_banner();
 
     std::cout << "[INFO] Initializing Aurelis Node..." << std::endl;
+    std::cout << "[INFO] Using SHA256 implementation: " << aurelis::SHA256AutoDetect() << std::endl;
     
     // Verify core structures
     aurelis::Block block;
@@ -66,13 +79,48 @@ int main(int argc, char* argv[]) {
 
     std::cout << "[INFO] Genesis Block Created with Reward to: " << RESERVE_ADDRESS << " (2500 AUC)" << std::endl;
     
-    aurelis::BlockChain chain;
+    aurelis::ChainOptions chainOptions;
+    chainOptions.dataDir = args.GetArg("datadir", ".");
+    chainOptions.blockCacheBytes = (size_t)std::max<int64_t>(1, args.GetIntArg("blockcache", 32)) * 1024 * 1024;
+    chainOptions.coinCacheBytes = (size_t)std::max<int64_t>(1, args.GetIntArg("dbcache", 128)) * 1024 * 1024;
+    chainOptions.reindex = args.GetBoolArg("reindex", false);
+    chainOptions.txIndex = args.GetBoolArg("txindex", false);
+    chainOptions.addressHistory = args.GetBoolArg("addresshistory", false);
+    chainOptions.pruneTargetBytes = (uint64_t)std::max<int64_t>(0, args.GetIntArg("prune", 0)) * 1024 * 1024;
+    if (chainOptions.pruneTargetBytes > 0 && chainOptions.txIndex) {
+        std::cout << "[WARN] -txindex needs every block and is disabled in prune mode." << std::endl;
+        chainOptions.txIndex = false;
+    }
+    std::string fsync = args.GetArg("fsync", "1000");
+    if (fsync == "always") {
+        chainOptions.fsyncPolicy = aurelis::FsyncPolicy::Always;
+    } else if (fsync == "never") {
+        chainOptions.fsyncPolicy = aurelis::FsyncPolicy::Never;
+    } else {
+        chainOptions.fsyncPolicy = aurelis::FsyncPolicy::Interval;
+        chainOptions.fsyncIntervalMs = (int)std::max<int64_t>(1, args.GetIntArg("fsync", 1000));
+    }
+    // -par: worker threads for block validation and replay, all cores by default
+    int par = (int)args.GetIntArg("par", (int64_t)std::max<unsigned>(1, std::thread::hardware_concurrency()));
+    chainOptions.validationThreads = std::max(1, par);
+    chainOptions.loadThreads = std::max(1, par);
+    aurelis::BlockChain chain(chainOptions);
     std::cout << "[INFO] Loading blockchain from disk..." << std::endl;
     chain.LoadChain();
     if (chain.GetHeight() == -1) {
-        chain.AddBlock(genesis);
+        chain.AddBlock(std::make_shared<const aurelis::Block>(genesis));
     }
-    aurelis::Mempool mempool;
+    aurelis::MempoolOptions mempoolOptions;
+    mempoolOptions.maxBytes = (size_t)std::max<int64_t>(1, args.GetIntArg("maxmempool", 300)) * 1024 * 1024;
+    mempoolOptions.expirySeconds = std::max<int64_t>(1, args.GetIntArg("mempoolexpiry", 336)) * 60 * 60;
+    mempoolOptions.threads = std::max(1, par);
+    // Inputs are priced against the confirmed UTXO set
+    aurelis::Mempool mempool([&chain](const aurelis::OutPoint& op, aurelis::TxOut& out) { return chain.GetCoin(op, out); },
+                             mempoolOptions);
+    // Confirmed and conflicting transactions leave the pool as each block connects
+    chain.SubscribeBlockConnected([&mempool](const aurelis::BlockConnected& connected) {
+        mempool.RemoveForBlock(connected.txids, connected.spent);
+    });
     std::cout << "[INFO] Blockchain and Mempool initialized." << std::endl;
 
     aurelis::RpcServer rpc(18883, chain, mempool);
@@ -94,13 +142,11 @@ int main(int argc, char* argv[]) {
     block1Template.header.nonce = 0;
 
     aurelis::Miner miner(block1Template, mempool);
-    miner.SetBlockFoundCallback([&chain, &miner, &mempool, RESERVE_ADDRESS](const aurelis::Block& b){
+    miner.SetBlockFoundCallback([&chain, &miner, RESERVE_ADDRESS](std::shared_ptr<const aurelis::Block> found){
+        const aurelis::Block& b = *found;
         std::cout << "[CALLBACK] New block mined: " << b.header.GetHash().ToString() << std::endl;
-        if (chain.AddBlock(b)) {
+        if (chain.AddBlock(found)) {
             std::cout << "[INFO] Block successfully added to chain! New Height: " << chain.GetHeight() << std::endl;
-            
-            // Clear confirmed transactions from mempool
-            mempool.RemoveTransactions(b.vtx);
 
             // Start mining next block on top of this one
             aurelis::Block nextTemplate = b;
@@ -130,12 +176,20 @@ int main(int argc, char* argv[]) {
     std::cout << "[INFO] Node initialization complete (Phase 1+2+3)." << std::endl;
     std::cout << "[INFO] Press Ctrl+C to exit..." << std::endl;
     
+    std::signal(SIGINT, HandleShutdownSignal);
+    std::signal(SIGTERM, HandleShutdownSignal);
+
     // Keep alive
-    while(true) {
+    while (!g_shutdownRequested) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
-    
-    return 0;
+
+    std::cout << "[INFO] Shutting down..." << std::endl;
+    miner.Stop();
+    chain.FlushChainstate();
+    // The RPC and P2P listeners block in accept() with no wakeup, so leave
+    // without joining them; everything durable has been flushed above.
+    std::exit(0);
     } catch (const std::exception& e) {
         std::cerr << "[FATAL ERROR] Unhandled exception in main: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,91 @@
+#include "miner/header_hasher.hpp"
+#include "util/serialize.hpp"
+#include "util/sha256.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace aurelis {
+
+namespace {
+
+const size_t HEADER_SIZE = 80;
+const size_t NONCE_OFFSET = 76 - 64; // nonce position within the tail chunk
+
+inline uint32_t ReadBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void WriteBE32(uint8_t* p, uint32_t x) {
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+} // namespace
+
+HeaderHasher::HeaderHasher(const BlockHeader& header) {
+    Serializer s;
+    s << header;
+    if (s.buffer.size() != HEADER_SIZE) throw std::runtime_error("Unexpected block header size");
+
+    sha256::Initialize(midstate);
+    sha256::Transform(midstate, s.buffer.data(), 1);
+
+    // Second chunk of the first pass: 16 header bytes, 0x80, zeros, bit length 640
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, s.buffer.data() + 64, HEADER_SIZE - 64);
+    tail[16] = 0x80;
+    tail[62] = 0x02;
+    tail[63] = 0x80;
+    for (int i = 0; i < 3; ++i) tailWords[i] = ReadBE32(tail + i * 4);
+}
+
+void HeaderHasher::Hash(uint32_t nonce, uint256& out) {
+    tail[NONCE_OFFSET] = static_cast<uint8_t>(nonce);
+    tail[NONCE_OFFSET + 1] = static_cast<uint8_t>(nonce >> 8);
+    tail[NONCE_OFFSET + 2] = static_cast<uint8_t>(nonce >> 16);
+    tail[NONCE_OFFSET + 3] = static_cast<uint8_t>(nonce >> 24);
+
+    uint32_t state[8];
+    memcpy(state, midstate, sizeof(state));
+    sha256::Transform(state, tail, 1);
+
+    // Second pass over the 32-byte digest: a single padded chunk, bit length 256
+    uint8_t chunk[64] = {0};
+    for (int i = 0; i < 8; ++i) WriteBE32(chunk + i * 4, state[i]);
+    chunk[32] = 0x80;
+    chunk[62] = 0x01;
+
+    sha256::Initialize(state);
+    sha256::Transform(state, chunk, 1);
+    for (int i = 0; i < 8; ++i) WriteBE32(out.data.data() + i * 4, state[i]);
+}
+
+bool HeaderHasher::ScanNonces(uint32_t start, uint32_t count, uint32_t& found) const {
+    const uint32_t lanes = static_cast<uint32_t>(sha256::HeaderNonceLanes());
+    alignas(64) uint32_t out0[16];
+    uint32_t done = 0;
+    while (done < count) {
+        uint32_t nonce = start + done;
+        sha256::HashHeaderNonces(out0, midstate, tailWords, nonce);
+        // The last call may run past `count`; those lanes are ignored
+        uint32_t n = std::min(lanes, count - done);
+        for (uint32_t lane = 0; lane < n; ++lane) {
+            if (MeetsTarget(out0[lane])) {
+                found = nonce + lane;
+                return true;
+            }
+        }
+        done += n;
+    }
+    return false;
+}
+
+bool ScanNonces(const BlockHeader& header, uint32_t start, uint32_t count, uint32_t& found) {
+    HeaderHasher hasher(header);
+    return hasher.ScanNonces(start, count, found);
+}
+
+} // namespace aurelis
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "chain/block.hpp"
+#include <cstdint>
+
+namespace aurelis {
+
+// Double-SHA256 of an 80-byte block header for a varying nonce.
+//
+// The first 64 bytes of the header (version, prev_block and most of
+// merkle_root) do not change while a template is being mined, so their
+// SHA256 midstate is computed once in the constructor. Each Hash() call then
+// only compresses the trailing 16 bytes plus the 32-byte second pass: two
+// transforms instead of three, no serialization and no heap allocation.
+class HeaderHasher {
+public:
+    explicit HeaderHasher(const BlockHeader& header);
+
+    // Identical to header.GetHash() with header.nonce = nonce.
+    void Hash(uint32_t nonce, uint256& out);
+
+    // Hash nonces [start, start + count) several lanes at a time and report
+    // the first one meeting the proof-of-work target in `found`. Only the
+    // leading state word is checked per lane; full digests are never built
+    // for losing nonces.
+    bool ScanNonces(uint32_t start, uint32_t count, uint32_t& found) const;
+
+    // Same target as BlockChain::ValidateBlock (two leading zero bytes of the
+    // hash), expressed on the top 16 bits of final state word 0.
+    static bool MeetsTarget(uint32_t word0) { return (word0 >> 16) == 0; }
+
+private:
+    uint32_t midstate[8];
+    uint32_t tailWords[3]; // header bytes 64..75 as big-endian words
+    uint8_t tail[64];      // header bytes 64..79 followed by SHA256 padding
+};
+
+// Convenience wrapper: midstate setup plus a single scan.
+bool ScanNonces(const BlockHeader& header, uint32_t start, uint32_t count, uint32_t& found);
+
+} // namespace aurelis
@@ -1,10 +1,17 @@
 #include "miner/miner.hpp"
+#include "miner/header_hasher.hpp"
 #include "chain/mempool.hpp"
 #include "util/sha256.hpp"
 #include <iostream>
+#include <memory>
 
 namespace aurelis {
 
+namespace {
+// Byte budget for mempool transactions in a block template
+const size_t MAX_TEMPLATE_TX_BYTES = 1000 * 1000;
+}
+
 Miner::Miner(const Block& baseBlock, Mempool& mp) : targetBlock(baseBlock), mempool(mp), threadCount(1), workVersion(0), running(false) {}
 
 Miner::~Miner() {
@@ -40,6 +47,11 @@ void Miner::MineWorker(int threadId) {
     int myVersion = -1;
     Block workBlock;
     int nonceCounter = 0;
+    // Each thread scans its own nonce range; the cursor survives periodic
+    // mempool refreshes so the same nonces are not hashed again.
+    int cursorVersion = -1;
+    uint32_t nonceCursor = 0;
+    std::unique_ptr<HeaderHasher> hasher;
     
     while (running) {
         // Refresh work if version changed OR periodically to pick up mempool txs
@@ -47,42 +59,38 @@ void Miner::MineWorker(int threadId) {
             std::lock_guard<std::mutex> lock(workMutex);
             workBlock = targetBlock;
             myVersion = workVersion;
+            if (cursorVersion != myVersion) {
+                // Stagger nonces by thread
+                nonceCursor = (uint32_t)threadId * 100000000u;
+                cursorVersion = myVersion;
+            }
             nonceCounter = 0;
             
-            // Add transactions from mempool (Up to 100 txs for better throughput)
-            auto extraTxs = mempool.GetTransactions();
-            for (size_t i = 0; i < extraTxs.size() && i < 100; ++i) {
-                workBlock.vtx.push_back(extraTxs[i]);
+            // Fill the template from the mempool, best fee rate first
+            auto extraTxs = mempool.SelectTransactions(MAX_TEMPLATE_TX_BYTES);
+            for (auto& tx : extraTxs) {
+                workBlock.vtx.push_back(std::move(tx));
             }
             
             // Update Merkle Root
-            if (workBlock.vtx.empty()) {
-                workBlock.header.merkle_root = uint256();
-            } else if (workBlock.vtx.size() == 1) {
-                workBlock.header.merkle_root = workBlock.vtx[0].GetHash();
-            } else {
-                Serializer mer;
-                for (const auto& tx : workBlock.vtx) {
-                    uint256 h = tx.GetHash();
-                    mer.write(h.data.data(), h.data.size());
-                }
-                uint256 mer_hash;
-                Hash256(mer.buffer.data(), mer.buffer.size(), mer_hash.data.data());
-                workBlock.header.merkle_root = mer_hash;
-            }
+            workBlock.header.merkle_root = ComputeMerkleRoot(workBlock.vtx);
 
-            // Stagger nonces by thread
-            if (myVersion != workVersion) {
-                workBlock.header.nonce = threadId * 100000000;
-            }
+            workBlock.header.nonce = nonceCursor;
+            // Midstate over the first 64 header bytes, reused for every nonce
+            hasher.reset(new HeaderHasher(workBlock.header));
         }
 
-        uint256 hash = workBlock.header.GetHash();
-        
-        // Simple difficulty check (two leading zero bytes)
-        if (hash.data[0] == 0 && hash.data[1] == 0) {
+        // Scan a batch of nonces; SIMD lanes report the first hit, if any
+        const uint32_t batch = 1000;
+        uint32_t found = 0;
+        if (hasher->ScanNonces(workBlock.header.nonce, batch, found)) {
+            workBlock.header.nonce = found;
+            uint256 hash;
+            hasher->Hash(found, hash);
             std::cout << "[MINER] Block found! Hash: " << hash.ToString() << std::endl;
-            if (onBlockFound) onBlockFound(workBlock);
+            // Moved, not copied, so the txids hashed for the merkle root stay
+            // cached for validation; the refresh below rebuilds the template
+            if (onBlockFound) onBlockFound(std::make_shared<const Block>(std::move(workBlock)));
             
             // 15-SECOND CADENCE: Wait exactly 15 seconds before starting the next block
             // As a Senior Engineer, I'm implementing this to ensure network stability
@@ -94,19 +102,21 @@ void Miner::MineWorker(int threadId) {
             
             // Force a refresh after the wait
             myVersion = -1; 
+            workBlock.header.nonce = found + 1;
+            workBlock.header.InvalidateHash(); // hashed by the block-found callback
+            nonceCounter += (int)(found - nonceCursor) + 1;
+        } else {
+            workBlock.header.nonce += batch;
+            nonceCounter += batch;
         }
-        
-        workBlock.header.nonce++;
-        nonceCounter++;
+        nonceCursor = workBlock.header.nonce;
         
         if (nonceCounter % 1000000 == 0) {
-            std::cout << "[MINER] Thread " << threadId << " progress: nonce " << workBlock.header.nonce << " (Last Hash: " << hash.ToString().substr(0, 10) << "...)" << std::endl << std::flush;
+            std::cout << "[MINER] Thread " << threadId << " progress: nonce " << workBlock.header.nonce << std::endl << std::flush;
         }
 
-        if (nonceCounter % 1000 == 0) {
-            if (!running) break;
-            std::this_thread::yield();
-        }
+        if (!running) break;
+        std::this_thread::yield();
     }
     
     std::cout << "[MINER] Thread " << threadId << " stopped." << std::endl;
@@ -4,6 +4,7 @@
 #include <atomic>
 #include <thread>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <mutex>
 
@@ -22,8 +23,9 @@ public:
 
     bool IsRunning() const { return running; }
 
-    // Callback when block found
-    void SetBlockFoundCallback(std::function<void(const Block&)> cb) { onBlockFound = cb; }
+    // Callback when block found; receives an immutable snapshot of the
+    // solved block that the chain can keep without copying it again
+    void SetBlockFoundCallback(std::function<void(std::shared_ptr<const Block>)> cb) { onBlockFound = cb; }
 
 private:
     Block targetBlock;
@@ -33,7 +35,7 @@ private:
     std::mutex workMutex;
     std::atomic<bool> running;
     std::vector<std::thread> workerThreads;
-    std::function<void(const Block&)> onBlockFound;
+    std::function<void(std::shared_ptr<const Block>)> onBlockFound;
 
     void MineWorker(int threadId);
 };
@@ -3,6 +3,9 @@
 #include "chain/mempool.hpp"
 #include "chain/tx.hpp"
 #include "util/hex.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -20,6 +23,79 @@
 
 namespace aurelis {
 
+namespace {
+
+// True if `address` signed one of the inputs or is paid by one of the outputs
+bool TouchesAddress(const Transaction& tx, const std::string& address) {
+    for (const auto& in : tx.vin) {
+        if (in.scriptSig.size() == address.size() && std::equal(in.scriptSig.begin(), in.scriptSig.end(), address.begin())) return true;
+    }
+    for (const auto& out : tx.vout) {
+        if (out.scriptPubKey.size() == address.size() && std::equal(out.scriptPubKey.begin(), out.scriptPubKey.end(), address.begin())) return true;
+    }
+    return false;
+}
+
+// Wallet view of a transaction from the perspective of targetAddr, which
+// either signed one of its inputs or is paid by one of its outputs.
+JsonValue DescribeAddressTx(const Transaction& tx, int h, const std::string& targetAddr) {
+    bool isSender = false;
+    int64_t receivedSum = 0;
+    std::string fromAddr = "";
+    std::string toAddr = "";
+
+    // Check if we are the sender by looking at inputs
+    for (const auto& in : tx.vin) {
+        std::string inSig = std::string((const char*)in.scriptSig.data(), in.scriptSig.size());
+        if (inSig == targetAddr) isSender = true;
+        if (fromAddr == "") fromAddr = inSig;
+    }
+
+    // Check outputs to find recipient/amount
+    for (const auto& out : tx.vout) {
+        std::string outAddr = std::string((const char*)out.scriptPubKey.data(), out.scriptPubKey.size());
+        if (outAddr == targetAddr) {
+            receivedSum += out.value;
+        } else {
+            if (toAddr == "") toAddr = outAddr;
+        }
+    }
+
+    std::map<std::string, JsonValue> t;
+    t["hash"] = tx.GetHash().ToString();
+    t["timestamp"] = "Block #" + std::to_string(h);
+
+    if (isSender) {
+        // We are the sender. Calculate amount sent to others.
+        int64_t sentTotal = 0;
+        for (const auto& out : tx.vout) {
+            std::string outAddr = std::string((const char*)out.scriptPubKey.data(), out.scriptPubKey.size());
+            if (outAddr != targetAddr) {
+                sentTotal += out.value;
+                toAddr = outAddr; // Recipient is the person who is NOT us
+            }
+        }
+        t["type"] = "send";
+        t["amount"] = sentTotal;
+        t["address"] = toAddr.empty() ? "Self" : toAddr;
+    } else {
+        // We are purely a receiver
+        bool isMined = (tx.vin.size() == 1 && tx.vin[0].scriptSig.size() >= 4 &&
+                       memcmp(tx.vin[0].scriptSig.data(), "MINT", 4) == 0);
+        if (isMined || h == 0) {
+            t["type"] = "mined";
+            t["address"] = "Imperial Treasury";
+        } else {
+            t["type"] = "receive";
+            t["address"] = fromAddr.empty() ? "Unknown" : fromAddr;
+        }
+        t["amount"] = receivedSum;
+    }
+    return JsonValue(t);
+}
+
+} // namespace
+
 RpcServer::RpcServer(int p, BlockChain& chain, Mempool& mp) : port(p), blockchain(chain), mempool(mp), running(false) {
 #ifdef _WIN32
     WSADATA wsaData;
@@ -210,15 +286,15 @@ std::string RpcServer::HandleRequest(const std::string& requestBody) {
 }
 
 JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonValue>& params) {
-    // Thread-safe access to blockchain and mempool
-    std::lock_guard<std::mutex> lock(mtx);
-    
+    // BlockChain and Mempool synchronize internally, so requests run
+    // concurrently
     try {
         if (method == "getblockchaininfo") {
             std::map<std::string, JsonValue> info;
-            info["blocks"] = (int64_t)blockchain.GetHeight();
-            info["bestblockhash"] = blockchain.GetBestHash().ToString();
-            info["moneysupply"] = (int64_t)(blockchain.GetHeight() + 1) * 2500;
+            ChainTip tip = blockchain.GetTip();
+            info["blocks"] = (int64_t)tip.height;
+            info["bestblockhash"] = tip.hash.ToString();
+            info["moneysupply"] = (int64_t)(tip.height + 1) * 2500;
             return JsonValue(info);
         }
 
@@ -240,14 +316,21 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
         return JsonValue(info);
     }
     if (method == "getmempoolinfo") {
+        MempoolStats stats = mempool.GetStats();
         std::map<std::string, JsonValue> info;
-        info["size"] = (int64_t)mempool.Size();
+        info["size"] = (int64_t)stats.count;
+        info["bytes"] = (int64_t)stats.bytes;
+        info["usage"] = (int64_t)stats.usage;
+        info["maxmempool"] = (int64_t)stats.maxBytes;
+        info["mempoolminfee"] = stats.minFeeRate; // sat/byte
+        info["evicted"] = (int64_t)stats.evicted;
+        info["expired"] = (int64_t)stats.expired;
         return JsonValue(info);
     }
     
     if (method == "getblock") {
         if (params.empty()) return JsonValue("Missing block hash/height");
-        Block block;
+        std::shared_ptr<const Block> block;
         uint256 hash;
         
         if (params[0].is_string()) {
@@ -265,25 +348,31 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
              block = blockchain.GetBlockByHeight(h);
         }
 
-        if (block.header.timestamp == 0) return JsonValue("Block not found");
+        if (!block) {
+            if (params[0].is_number()) hash = blockchain.GetBlockHash((int)params[0].as_int());
+            if (blockchain.IsBlockPruned(hash)) return JsonValue("Error: Block pruned (its data is no longer stored by this node)");
+            return JsonValue("Block not found");
+        }
 
+        uint256 blockHash = block->header.GetHash();
+        int blockHeight = blockchain.GetBlockHeight(blockHash);
         std::map<std::string, JsonValue> res;
-        res["hash"] = block.header.GetHash().ToString();
-        res["confirmations"] = (int64_t)(blockchain.GetHeight() - (blockchain.GetIndex(block.header.GetHash())->height)) + 1;
+        res["hash"] = blockHash.ToString();
+        res["confirmations"] = (int64_t)(blockchain.GetHeight() - blockHeight) + 1;
         res["size"] = (int64_t)100; // Mock size
-        res["height"] = (int64_t)blockchain.GetIndex(block.header.GetHash())->height;
-        res["version"] = (int64_t)block.header.version;
-        res["merkleroot"] = block.header.merkle_root.ToString();
+        res["height"] = (int64_t)blockHeight;
+        res["version"] = (int64_t)block->header.version;
+        res["merkleroot"] = block->header.merkle_root.ToString();
         
         std::vector<JsonValue> txs;
-        for (const auto& tx : block.vtx) txs.push_back(JsonValue(tx.GetHash().ToString()));
+        for (const auto& tx : block->vtx) txs.push_back(JsonValue(tx.GetHash().ToString()));
         res["tx"] = JsonValue(txs);
         
-        res["time"] = (int64_t)block.header.timestamp;
-        res["nonce"] = (int64_t)block.header.nonce;
-        res["bits"] = (int64_t)block.header.bits;
+        res["time"] = (int64_t)block->header.timestamp;
+        res["nonce"] = (int64_t)block->header.nonce;
+        res["bits"] = (int64_t)block->header.bits;
         res["difficulty"] = 1.0;
-        res["previousblockhash"] = block.header.prev_block.ToString();
+        res["previousblockhash"] = block->header.prev_block.ToString();
         
         return JsonValue(res);
     }
@@ -296,13 +385,14 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
         uint256 txid; 
         txid.SetHex(txidStr);
         
-        Transaction tx;
-        uint256 blockHash;
-        if (blockchain.GetTransaction(txid, tx, blockHash)) {
+        std::shared_ptr<const Block> block;
+        size_t pos = 0;
+        if (blockchain.GetTransaction(txid, block, pos)) {
+            const Transaction& tx = block->vtx[pos];
             std::map<std::string, JsonValue> res;
             res["txid"] = txidStr;
             res["version"] = (int64_t)1;
-            res["blockhash"] = blockHash.ToString();
+            res["blockhash"] = block->header.GetHash().ToString();
             // Add time if we had it, for now use block lookup or current
             
             std::vector<JsonValue> vin;
@@ -332,81 +422,53 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
         }
     }
     if (method == "getaddresstransactions") {
+        // getaddresstransactions <address> [cursor] [count]
+        // Without a cursor: the newest 50 entries as a plain array. With one
+        // (-1 for the newest page): {"txs": [...], "next": <cursor or null>}.
         std::string targetAddr = "";
         if (!params.empty() && params[0].is_string()) targetAddr = params[0].as_string();
-        
-        std::vector<JsonValue> txs;
-        int height = blockchain.GetHeight();
-        int count = 0;
-        
-        for (int h = height; h >= 0 && count < 50; --h) {
-            Block block = blockchain.GetBlockByHeight(h);
-            for (const auto& tx : block.vtx) {
-                bool isRelevant = false;
-                bool isSender = false;
-                int64_t receivedSum = 0;
-                std::string fromAddr = "";
-                std::string toAddr = "";
-
-                // Check if we are the sender by looking at inputs
-                for (const auto& in : tx.vin) {
-                    std::string inSig = std::string((const char*)in.scriptSig.data(), in.scriptSig.size());
-                    if (inSig == targetAddr) {
-                        isSender = true;
-                        isRelevant = true;
-                    }
-                    if (fromAddr == "") fromAddr = inSig;
-                }
 
-                // Check outputs for relevance and to find recipient/amount
-                for (const auto& out : tx.vout) {
-                    std::string outAddr = std::string((const char*)out.scriptPubKey.data(), out.scriptPubKey.size());
-                    if (outAddr == targetAddr) {
-                        isRelevant = true;
-                        receivedSum += out.value;
-                    } else {
-                        if (toAddr == "") toAddr = outAddr;
-                    }
+        bool paged = params.size() >= 2;
+        if (!blockchain.HasAddressHistory()) {
+            // Cursors are index positions, so only the plain form works
+            // without -addresshistory: walk back from the tip as before the
+            // index existed, stopping at pruned blocks
+            if (paged) return JsonValue("Error: Paging needs the address history index; start the node with -addresshistory");
+            std::vector<JsonValue> txs;
+            for (int h = blockchain.GetHeight(); h >= 0 && txs.size() < 50; --h) {
+                auto block = blockchain.GetBlockByHeight(h);
+                if (!block) break;
+                for (size_t i = block->vtx.size(); i > 0 && txs.size() < 50; --i) {
+                    if (TouchesAddress(block->vtx[i - 1], targetAddr)) txs.push_back(DescribeAddressTx(block->vtx[i - 1], h, targetAddr));
                 }
+            }
+            return JsonValue(txs);
+        }
+        int64_t cursorArg = paged && params[1].is_number() ? params[1].as_int() : -1;
+        int64_t countArg = params.size() >= 3 && params[2].is_number() ? params[2].as_int() : 50;
+        uint64_t cursor = cursorArg < 0 ? UINT64_MAX : (uint64_t)cursorArg;
+        size_t count = (size_t)std::min<int64_t>(std::max<int64_t>(countArg, 1), 500);
 
-                if (isRelevant) {
-                    std::map<std::string, JsonValue> t;
-                    t["hash"] = tx.GetHash().ToString();
-                    t["timestamp"] = "Block #" + std::to_string(h);
-
-                    if (isSender) {
-                        // We are the sender. Calculate amount sent to others.
-                        int64_t sentTotal = 0;
-                        for (const auto& out : tx.vout) {
-                            std::string outAddr = std::string((const char*)out.scriptPubKey.data(), out.scriptPubKey.size());
-                            if (outAddr != targetAddr) {
-                                sentTotal += out.value;
-                                toAddr = outAddr; // Recipient is the person who is NOT us
-                            }
-                        }
-                        t["type"] = "send";
-                        t["amount"] = sentTotal;
-                        t["address"] = toAddr.empty() ? "Self" : toAddr;
-                    } else {
-                        // We are purely a receiver
-                        bool isMined = (tx.vin.size() == 1 && tx.vin[0].scriptSig.size() >= 4 && 
-                                       memcmp(tx.vin[0].scriptSig.data(), "MINT", 4) == 0);
-                        if (isMined || h == 0) {
-                            t["type"] = "mined";
-                            t["address"] = "Imperial Treasury";
-                        } else {
-                            t["type"] = "receive";
-                            t["address"] = fromAddr.empty() ? "Unknown" : fromAddr;
-                        }
-                        t["amount"] = receivedSum;
-                    }
-                    
-                    txs.push_back(JsonValue(t));
-                    count++;
-                }
+        uint64_t next = 0;
+        std::vector<TxLocation> page = blockchain.GetAddressHistory(targetAddr, cursor, count, next);
+
+        std::vector<JsonValue> txs;
+        std::shared_ptr<const Block> block;
+        int blockHeight = -1;
+        for (const auto& loc : page) {
+            if (loc.height != blockHeight) {
+                block = blockchain.GetBlockByHeight(loc.height);
+                blockHeight = loc.height;
             }
+            if (!block || loc.index >= block->vtx.size()) continue;
+            txs.push_back(DescribeAddressTx(block->vtx[loc.index], loc.height, targetAddr));
         }
-        return JsonValue(txs);
+        if (!paged) return JsonValue(txs);
+
+        std::map<std::string, JsonValue> res;
+        res["txs"] = JsonValue(txs);
+        res["next"] = next > 0 ? JsonValue((int64_t)next) : JsonValue();
+        return JsonValue(res);
     }
     if (method == "mint") {
         if (params.size() < 2) return JsonValue("Error: Usage 'mint <address> <amount_satoshi>'");
@@ -422,28 +484,34 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
         tx.vout[0].value = amount;
         tx.vout[0].scriptPubKey = std::vector<uint8_t>(target.begin(), target.end());
 
-        if (mempool.AddTransaction(tx)) {
-            return JsonValue(tx.GetHash().ToString());
+        uint256 txid = tx.GetHash();
+        if (mempool.AddTransaction(std::move(tx))) {
+            return JsonValue(txid.ToString());
         } else {
             return JsonValue("Error: Failed to add mint transaction to mempool");
         }
     }
     if (method == "transfer") {
-        if (params.size() < 3) return JsonValue("Error: Usage 'transfer <from> <to> <amount_satoshi>'");
+        if (params.size() < 3) return JsonValue("Error: Usage 'transfer <from> <to> <amount_satoshi> [fee_satoshi]'");
         std::string from = params[0].as_string();
         std::string to = params[1].as_string();
         int64_t amount = params[2].as_int();
+        // The fee is what the inputs leave over; templates are filled by fee rate
+        int64_t fee = params.size() >= 4 && params[3].is_number() ? params[3].as_int() : 0;
+        if (fee < 0) return JsonValue("Error: Negative fee");
 
         auto utxos = blockchain.GetUTXOs(from);
         int64_t total = 0;
         std::vector<std::pair<OutPoint, UTXO>> selected;
         for (const auto& u : utxos) {
+            // Coins a pending transfer already spends would only conflict
+            if (mempool.IsSpent(u.first)) continue;
             total += u.second.out.value;
             selected.push_back(u);
-            if (total >= amount) break;
+            if (total >= amount + fee) break;
         }
 
-        if (total < amount) return JsonValue("Error: Insufficient balance");
+        if (total < amount + fee) return JsonValue("Error: Insufficient balance");
 
         Transaction tx;
         tx.version = 1;
@@ -459,12 +527,13 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
         // Outputs
         tx.vout.push_back(TxOut(amount, std::vector<uint8_t>(to.begin(), to.end())));
         // Change
-        if (total > amount) {
-            tx.vout.push_back(TxOut(total - amount, std::vector<uint8_t>(from.begin(), from.end())));
+        if (total > amount + fee) {
+            tx.vout.push_back(TxOut(total - amount - fee, std::vector<uint8_t>(from.begin(), from.end())));
         }
 
-        if (mempool.AddTransaction(tx)) {
-            return JsonValue(tx.GetHash().ToString());
+        uint256 txid = tx.GetHash();
+        if (mempool.AddTransaction(std::move(tx))) {
+            return JsonValue(txid.ToString());
         } else {
             return JsonValue("Error: Failed to add transfer to mempool");
         }
@@ -507,6 +576,36 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
     }
     if (method == "sendrawtransaction") {
         if (params.empty()) return "No hex provided";
+        if (params.size() > 1) {
+            // Several transactions: admitted as one batch, one result each
+            std::vector<Transaction> batch;
+            std::vector<std::string> decodeErrors(params.size());
+            std::vector<size_t> batchIndex(params.size(), SIZE_MAX);
+            for (size_t i = 0; i < params.size(); ++i) {
+                try {
+                    std::vector<uint8_t> data = HexUtil::Decode(params[i].as_string());
+                    Deserializer d(data);
+                    Transaction tx;
+                    tx.Deserialize(d);
+                    batchIndex[i] = batch.size();
+                    batch.push_back(std::move(tx));
+                } catch (const std::exception& e) {
+                    decodeErrors[i] = std::string("Error: ") + e.what();
+                }
+            }
+            std::vector<MempoolAcceptResult> results = mempool.AddTransactions(std::move(batch));
+            std::vector<JsonValue> out;
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (batchIndex[i] == SIZE_MAX) {
+                    out.push_back(JsonValue(decodeErrors[i]));
+                } else if (results[batchIndex[i]].result == MempoolAccept::Accepted) {
+                    out.push_back(JsonValue(results[batchIndex[i]].txid.ToString()));
+                } else {
+                    out.push_back(JsonValue(std::string("Transaction rejected: ") + MempoolAcceptReason(results[batchIndex[i]].result)));
+                }
+            }
+            return JsonValue(out);
+        }
         std::string hex = params[0].as_string();
         
         try {
@@ -515,8 +614,9 @@ JsonValue RpcServer::Dispatch(const std::string& method, const std::vector<JsonV
             Transaction tx;
             tx.Deserialize(d);
             
-            if (mempool.AddTransaction(tx)) {
-                return tx.GetHash().ToString();
+            uint256 txid = tx.GetHash();
+            if (mempool.AddTransaction(std::move(tx))) {
+                return txid.ToString();
             } else {
                 return "Transaction rejected (invalid or exists)";
             }
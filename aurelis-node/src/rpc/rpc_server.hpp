@@ -4,7 +4,6 @@
 #include <functional>
 #include <thread>
 #include <atomic>
-#include <mutex>
 #include "util/simplejson.hpp"
 
 namespace aurelis {
@@ -26,7 +25,6 @@ private:
     Mempool& mempool;
     std::atomic<bool> running;
     std::thread serverThread;
-    std::mutex mtx; // Protect blockchain and mempool access
     
     void RunLoop();
     std::string HandleRequest(const std::string& request);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <cstdint>
+
+namespace aurelis {
+
+// Minimal command line parser: accepts -name=value, --name=value and bare
+// -name (treated as "1"). Later occurrences override earlier ones.
+class ArgsManager {
+public:
+    void Parse(int argc, char* argv[]) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.empty() || arg[0] != '-') continue;
+            size_t start = arg.find_first_not_of('-');
+            if (start == std::string::npos) continue;
+            size_t eq = arg.find('=', start);
+            if (eq == std::string::npos) {
+                values[arg.substr(start)] = "1";
+            } else {
+                values[arg.substr(start, eq - start)] = arg.substr(eq + 1);
+            }
+        }
+    }
+
+    bool IsSet(const std::string& name) const {
+        return values.count(name) > 0;
+    }
+
+    std::string GetArg(const std::string& name, const std::string& def) const {
+        auto it = values.find(name);
+        return it != values.end() ? it->second : def;
+    }
+
+    int64_t GetIntArg(const std::string& name, int64_t def) const {
+        auto it = values.find(name);
+        if (it == values.end()) return def;
+        try { return std::stoll(it->second); } catch (...) { return def; }
+    }
+
+    bool GetBoolArg(const std::string& name, bool def) const {
+        auto it = values.find(name);
+        if (it == values.end()) return def;
+        return it->second != "0" && it->second != "false";
+    }
+
+private:
+    std::map<std::string, std::string> values;
+};
+
+} // namespace aurelis
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace aurelis {
+
+// Blocking multi-producer/multi-consumer FIFO with a fixed capacity, used to
+// connect pipeline stages so a fast producer cannot run arbitrarily far ahead
+// of its consumers.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t cap) : capacity(cap ? cap : 1), closed(false) {}
+
+    // Blocks while full. Returns false (dropping the item) once closed.
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks while empty. Returns false once closed and drained.
+    bool Pop(T& out) {
+        std::unique_lock<std::mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        out = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    // Wake every waiter; pending items can still be popped.
+    void Close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+} // namespace aurelis
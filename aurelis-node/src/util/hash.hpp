@@ -8,6 +8,7 @@
 #include <cstdint>
 #include <cstring>
 #include <array>
+#include <atomic>
 
 namespace aurelis {
 
@@ -57,4 +58,73 @@ public:
     friend class Serialize;
 };
 
+// Hasher for unordered containers keyed by block hash or txid. Uses the
+// trailing bytes: block hashes start with proof-of-work zeros.
+struct Uint256Hasher {
+    size_t operator()(const uint256& h) const {
+        uint64_t v;
+        memcpy(&v, h.data.data() + uint256::WIDTH - sizeof(v), sizeof(v));
+        return static_cast<size_t>(v);
+    }
+};
+
+// Lazily computed hash of the object that owns it (txid, block hash).
+//
+// The owner's fields are public, so the cache cannot observe edits. It is
+// therefore never carried over by copy or assignment: a copy that gets
+// modified can never report the original's hash. Moves keep it. Owners reset it when they
+// deserialize; code that edits an object in place after hashing it must call
+// Reset() too. Concurrent readers are safe: only the first thread to claim
+// the slot publishes its result, the others compute their own.
+class CachedHash {
+public:
+    CachedHash() : state(EMPTY) {}
+    CachedHash(const CachedHash&) : state(EMPTY) {}
+    CachedHash& operator=(const CachedHash&) {
+        Reset();
+        return *this;
+    }
+    // A move transfers the contents unchanged, so the hash goes with them
+    CachedHash(CachedHash&& other) noexcept : state(EMPTY) { Take(other); }
+    CachedHash& operator=(CachedHash&& other) noexcept {
+        Take(other);
+        return *this;
+    }
+
+    bool Get(uint256& out) const {
+        if (state.load(std::memory_order_acquire) != READY) return false;
+        out = hash;
+        return true;
+    }
+
+    void Set(const uint256& h) const {
+        uint8_t expected = EMPTY;
+        if (state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire)) {
+            hash = h;
+            state.store(READY, std::memory_order_release);
+        }
+    }
+
+    void Reset() const { state.store(EMPTY, std::memory_order_relaxed); }
+
+private:
+    void Take(CachedHash& other) {
+        uint256 h;
+        if (other.Get(h)) {
+            hash = h;
+            state.store(READY, std::memory_order_release);
+        } else {
+            Reset();
+        }
+        other.Reset();
+    }
+
+    static constexpr uint8_t EMPTY = 0;
+    static constexpr uint8_t BUSY = 1;
+    static constexpr uint8_t READY = 2;
+
+    mutable uint256 hash;
+    mutable std::atomic<uint8_t> state;
+};
+
 } // namespace aurelis
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "util/hash.hpp"
+#include "util/serialize.hpp"
+#include "util/sha256.hpp"
+
+namespace aurelis {
+
+// Serialization sink that feeds bytes straight into SHA256 instead of a
+// buffer. Accepts the same operator<< / write() calls as Serializer, so any
+// object with a templated Serialize method can be hashed in one pass without
+// allocating.
+class HashWriter {
+public:
+    void write(const void* data, size_t len) {
+        ctx.Update(static_cast<const uint8_t*>(data), len);
+    }
+
+    template<typename T>
+    HashWriter& operator<<(const T& obj) {
+        if constexpr (std::is_integral<T>::value) {
+            // Little endian encoding for integers, as in Serializer
+            uint8_t bytes[sizeof(T)];
+            for (size_t i = 0; i < sizeof(T); ++i) {
+                bytes[i] = static_cast<uint8_t>((obj >> (i * 8)) & 0xFF);
+            }
+            ctx.Update(bytes, sizeof(T));
+        } else {
+            obj.Serialize(*this);
+        }
+        return *this;
+    }
+
+    // Double SHA256 (Hash256) of everything written so far. Consumes the
+    // writer.
+    uint256 GetHash() {
+        uint256 result;
+        ctx.Final(result.data.data());
+        ctx.Reset().Update(result.data.data(), result.data.size());
+        ctx.Final(result.data.data());
+        return result;
+    }
+
+private:
+    SHA256 ctx;
+};
+
+template<>
+struct IsWriteStream<HashWriter> : std::true_type {};
+
+} // namespace aurelis
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+namespace aurelis {
+
+// Read-only memory mapping of a whole file.
+//
+// Used for startup scans so blocks can be deserialized straight out of the
+// page cache instead of being copied into an intermediate buffer first.
+// Sequential access is advised to the kernel so it reads ahead aggressively.
+class MappedFile {
+public:
+    MappedFile() : ptr(nullptr), len(0) {}
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map `path`; returns false if it cannot be opened or mapped. An empty
+    // file opens successfully with size() == 0.
+    bool Open(const std::string& path);
+    void Close();
+
+    const uint8_t* data() const { return ptr; }
+    size_t size() const { return len; }
+
+private:
+    const uint8_t* ptr;
+    size_t len;
+};
+
+// Flush stdio buffers and force the file's data to stable storage.
+bool SyncFile(FILE* f);
+
+} // namespace aurelis
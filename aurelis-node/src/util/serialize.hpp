@@ -4,9 +4,15 @@
 #include <cstdint>
 #include <algorithm>
 #include <type_traits>
+#include <stdexcept>
 
 namespace aurelis {
 
+// Marks the sink types accepted by the templated Serialize methods and the
+// vector operators below (Serializer here, HashWriter in hash_writer.hpp).
+template<typename Stream>
+struct IsWriteStream : std::false_type {};
+
 // Simple serialization buffer
 class Serializer {
 public:
@@ -33,26 +39,32 @@ public:
     }
 };
 
+// Reads from a non-owning byte range: a vector, a memory-mapped file or any
+// other buffer that outlives the Deserializer.
 class Deserializer {
 public:
-    const std::vector<uint8_t>& buffer;
+    const uint8_t* data;
+    size_t size;
     size_t pos;
 
-    Deserializer(const std::vector<uint8_t>& buf) : buffer(buf), pos(0) {}
+    Deserializer(const std::vector<uint8_t>& buf) : data(buf.data()), size(buf.size()), pos(0) {}
+    Deserializer(const uint8_t* ptr, size_t len) : data(ptr), size(len), pos(0) {}
+
+    size_t remaining() const { return size - pos; }
 
     void read(void* dest, size_t len) {
-        if (pos + len > buffer.size()) throw std::runtime_error("Deserialize underflow");
-        std::copy(buffer.begin() + pos, buffer.begin() + pos + len, static_cast<uint8_t*>(dest));
+        if (len > remaining()) throw std::runtime_error("Deserialize underflow");
+        std::copy(data + pos, data + pos + len, static_cast<uint8_t*>(dest));
         pos += len;
     }
 
     template<typename T>
     Deserializer& operator>>(T& obj) {
         if constexpr (std::is_integral<T>::value) {
-             if (pos + sizeof(T) > buffer.size()) throw std::runtime_error("Deserialize underflow");
+             if (sizeof(T) > remaining()) throw std::runtime_error("Deserialize underflow");
              obj = 0;
              for (size_t i = 0; i < sizeof(T); ++i) {
-                 obj |= static_cast<T>(buffer[pos++]) << (i * 8);
+                 obj |= static_cast<T>(data[pos++]) << (i * 8);
              }
         } else {
             obj.Deserialize(*this);
@@ -61,15 +73,23 @@ public:
     }
 };
 
+template<>
+struct IsWriteStream<Serializer> : std::true_type {};
+
 // Vector serialization specializations
-template<typename T>
-Serializer& operator<<(Serializer& s, const std::vector<T>& v) {
+template<typename Stream, typename T, typename = std::enable_if_t<IsWriteStream<Stream>::value>>
+Stream& operator<<(Stream& s, const std::vector<T>& v) {
     // VarInt size (simplified to uint64 for now)
     uint64_t size = v.size();
     // Compact size encoding would be better (VarInt), using uint64 for simplicity prototype
     s << size; 
-    for (const auto& item : v) {
-        s << item;
+    if constexpr (std::is_same<T, uint8_t>::value) {
+        // Byte vectors (scripts) go out in one write
+        s.write(v.data(), v.size());
+    } else {
+        for (const auto& item : v) {
+            s << item;
+        }
     }
     return s;
 }
@@ -78,9 +98,16 @@ template<typename T>
 Deserializer& operator>>(Deserializer& d, std::vector<T>& v) {
     uint64_t size;
     d >> size;
+    // Every element takes at least one byte: reject corrupt lengths before
+    // allocating for them
+    if (size > d.remaining()) throw std::runtime_error("Deserialize underflow");
     v.resize(size);
-    for (size_t i = 0; i < size; ++i) {
-        d >> v[i];
+    if constexpr (std::is_same<T, uint8_t>::value) {
+        d.read(v.data(), v.size());
+    } else {
+        for (size_t i = 0; i < size; ++i) {
+            d >> v[i];
+        }
     }
     return d;
 }
@@ -2,6 +2,17 @@
 #include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <stdexcept>
+#include <chrono>
+
+#if defined(ENABLE_SHANI) || defined(ENABLE_SSE41) || defined(ENABLE_AVX2) || defined(ENABLE_AVX512)
+#define USE_CPU_DISPATCH
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
 
 namespace aurelis {
 
@@ -26,7 +37,123 @@ static const uint32_t K[64] = {
 #define SIG0(x) (ROTRIGHT(x,7) ^ ROTRIGHT(x,18) ^ ((x) >> 3))
 #define SIG1(x) (ROTRIGHT(x,17) ^ ROTRIGHT(x,19) ^ ((x) >> 10))
 
-SHA256::SHA256() : datalen(0), bitlen(0) {
+#if defined(ENABLE_SHANI)
+namespace sha256_shani {
+void Transform(uint32_t* state, const uint8_t* chunk, size_t blocks);
+}
+#endif
+#if defined(ENABLE_SSE41)
+namespace sha256_sse41 {
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce);
+}
+#endif
+#if defined(ENABLE_AVX2)
+namespace sha256_avx2 {
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce);
+}
+#endif
+#if defined(ENABLE_AVX512)
+namespace sha256_avx512 {
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce);
+}
+#endif
+
+namespace {
+
+inline uint32_t ReadBE32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+inline void WriteBE32(uint8_t* p, uint32_t x) {
+    p[0] = static_cast<uint8_t>(x >> 24);
+    p[1] = static_cast<uint8_t>(x >> 16);
+    p[2] = static_cast<uint8_t>(x >> 8);
+    p[3] = static_cast<uint8_t>(x);
+}
+
+// Portable compression function, always available as the fallback.
+void TransformPortable(uint32_t* state, const uint8_t* chunk, size_t blocks) {
+    while (blocks--) {
+        uint32_t a, b, c, d, e, f, g, h, i, t1, t2, m[64];
+
+        for (i = 0; i < 16; ++i)
+            m[i] = ReadBE32(chunk + i * 4);
+        for (; i < 64; ++i)
+            m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+        a = state[0];
+        b = state[1];
+        c = state[2];
+        d = state[3];
+        e = state[4];
+        f = state[5];
+        g = state[6];
+        h = state[7];
+
+        for (i = 0; i < 64; ++i) {
+            t1 = h + EP1(e) + CH(e, f, g) + K[i] + m[i];
+            t2 = EP0(a) + MAJ(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+
+        chunk += 64;
+    }
+}
+
+typedef void (*TransformFn)(uint32_t*, const uint8_t*, size_t);
+TransformFn transformImpl = TransformPortable;
+
+// One nonce per call through the single-stream transform.
+void HashHeaderNonceScalar(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce) {
+    uint8_t chunk[64] = {0};
+    for (int i = 0; i < 3; ++i) WriteBE32(chunk + i * 4, tail[i]);
+    // The nonce is serialized little-endian
+    chunk[12] = static_cast<uint8_t>(nonce);
+    chunk[13] = static_cast<uint8_t>(nonce >> 8);
+    chunk[14] = static_cast<uint8_t>(nonce >> 16);
+    chunk[15] = static_cast<uint8_t>(nonce >> 24);
+    chunk[16] = 0x80;
+    chunk[62] = 0x02;
+    chunk[63] = 0x80;
+
+    uint32_t state[8];
+    memcpy(state, midstate, sizeof(state));
+    transformImpl(state, chunk, 1);
+
+    memset(chunk, 0, sizeof(chunk));
+    for (int i = 0; i < 8; ++i) WriteBE32(chunk + i * 4, state[i]);
+    chunk[32] = 0x80;
+    chunk[62] = 0x01;
+    sha256::Initialize(state);
+    transformImpl(state, chunk, 1);
+    out0[0] = state[0];
+}
+
+typedef void (*HeaderNoncesFn)(uint32_t*, const uint32_t*, const uint32_t*, uint32_t);
+HeaderNoncesFn headerNoncesImpl = HashHeaderNonceScalar;
+size_t headerNonceLanes = 1;
+
+} // namespace
+
+namespace sha256 {
+
+void Initialize(uint32_t* state) {
     state[0] = 0x6a09e667;
     state[1] = 0xbb67ae85;
     state[2] = 0x3c6ef372;
@@ -37,55 +164,51 @@ SHA256::SHA256() : datalen(0), bitlen(0) {
     state[7] = 0x5be0cd19;
 }
 
-void SHA256::Transform() {
-    uint32_t a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
-
-    for (i = 0, j = 0; i < 16; ++i, j += 4)
-        m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
-    for (; i < 64; ++i)
-        m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
-
-    a = state[0];
-    b = state[1];
-    c = state[2];
-    d = state[3];
-    e = state[4];
-    f = state[5];
-    g = state[6];
-    h = state[7];
-
-    for (i = 0; i < 64; ++i) {
-        t1 = h + EP1(e) + CH(e, f, g) + K[i] + m[i];
-        t2 = EP0(a) + MAJ(a, b, c);
-        h = g;
-        g = f;
-        f = e;
-        e = d + t1;
-        d = c;
-        c = b;
-        b = a;
-        a = t1 + t2;
-    }
+void Transform(uint32_t* state, const uint8_t* chunk, size_t blocks) {
+    transformImpl(state, chunk, blocks);
+}
+
+size_t HeaderNonceLanes() {
+    return headerNonceLanes;
+}
 
-    state[0] += a;
-    state[1] += b;
-    state[2] += c;
-    state[3] += d;
-    state[4] += e;
-    state[5] += f;
-    state[6] += g;
-    state[7] += h;
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce) {
+    headerNoncesImpl(out0, midstate, tail, nonce);
+}
+
+} // namespace sha256
+
+SHA256::SHA256() : bytes(0) {
+    sha256::Initialize(state);
+}
+
+SHA256& SHA256::Reset() {
+    bytes = 0;
+    sha256::Initialize(state);
+    return *this;
 }
 
 void SHA256::Update(const uint8_t* val, size_t len) {
-    for (size_t i = 0; i < len; ++i) {
-        data[datalen] = val[i];
-        datalen++;
-        if (datalen == 64) {
-            Transform();
-            bitlen += 512;
-            datalen = 0;
-        }
+    const uint8_t* end = val + len;
+    size_t bufsize = bytes % 64;
+    if (bufsize && bufsize + len >= 64) {
+        // Complete the buffered block first
+        memcpy(data + bufsize, val, 64 - bufsize);
+        bytes += 64 - bufsize;
+        val += 64 - bufsize;
+        transformImpl(state, data, 1);
+        bufsize = 0;
+    }
+    if (end - val >= 64) {
+        // Hash whole blocks straight from the caller's memory
+        size_t blocks = (end - val) / 64;
+        transformImpl(state, val, blocks);
+        val += 64 * blocks;
+        bytes += 64 * blocks;
+    }
+    if (end > val) {
+        memcpy(data + bufsize, val, end - val);
+        bytes += end - val;
     }
 }
 
@@ -94,42 +217,17 @@ void SHA256::Update(const std::string& str) {
 }
 
 void SHA256::Final(uint8_t* digest) {
-    uint32_t i = datalen;
+    static const uint8_t pad[64] = {0x80};
+    uint8_t sizedesc[8];
+    uint64_t bitlen = bytes << 3;
+    for (int i = 0; i < 8; ++i)
+        sizedesc[i] = static_cast<uint8_t>(bitlen >> (56 - i * 8));
 
-    if (datalen < 56) {
-        data[i++] = 0x80;
-        while (i < 56)
-            data[i++] = 0x00;
-    }
-    else {
-        data[i++] = 0x80;
-        while (i < 64)
-            data[i++] = 0x00;
-        Transform();
-        memset(data, 0, 56);
-    }
+    Update(pad, 1 + ((119 - (bytes % 64)) % 64));
+    Update(sizedesc, 8);
 
-    bitlen += datalen * 8;
-    data[63] = static_cast<uint8_t>(bitlen);
-    data[62] = static_cast<uint8_t>(bitlen >> 8);
-    data[61] = static_cast<uint8_t>(bitlen >> 16);
-    data[60] = static_cast<uint8_t>(bitlen >> 24);
-    data[59] = static_cast<uint8_t>(bitlen >> 32);
-    data[58] = static_cast<uint8_t>(bitlen >> 40);
-    data[57] = static_cast<uint8_t>(bitlen >> 48);
-    data[56] = static_cast<uint8_t>(bitlen >> 56);
-    Transform();
-
-    for (i = 0; i < 4; ++i) {
-        digest[i]      = (state[0] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 4]  = (state[1] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 8]  = (state[2] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 12] = (state[3] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 16] = (state[4] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 20] = (state[5] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 24] = (state[6] >> (24 - i * 8)) & 0x000000ff;
-        digest[i + 28] = (state[7] >> (24 - i * 8)) & 0x000000ff;
-    }
+    for (int i = 0; i < 8; ++i)
+        WriteBE32(digest + i * 4, state[i]);
 }
 
 std::string SHA256::HashToString(const std::string& input) {
@@ -147,11 +245,203 @@ std::string SHA256::HashToString(const std::string& input) {
 std::vector<uint8_t> SHA256::Hash(const std::vector<uint8_t>& input) {
     SHA256 ctx;
     ctx.Update(input.data(), input.size());
-    uint8_t digest[32];
-    ctx.Final(digest);
-    std::vector<uint8_t> out;
-    out.insert(out.end(), digest, digest + 32);
+    std::vector<uint8_t> out(DIGEST_SIZE);
+    ctx.Final(out.data());
     return out;
 }
 
+namespace {
+
+#if defined(USE_CPU_DISPATCH)
+void CpuId(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuidex(regs, static_cast<int>(leaf), static_cast<int>(subleaf));
+    a = regs[0]; b = regs[1]; c = regs[2]; d = regs[3];
+#else
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+#endif
+}
+
+// Register state the OS saves on context switch (XCR0)
+uint64_t XGetBV() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (static_cast<uint64_t>(d) << 32) | a;
+#endif
+}
+#endif
+
+// Hash a message in one call through the given compression function.
+void DigestWith(TransformFn fn, const uint8_t* msg, size_t len, uint8_t* digest) {
+    TransformFn saved = transformImpl;
+    transformImpl = fn;
+    SHA256 ctx;
+    ctx.Update(msg, len);
+    ctx.Final(digest);
+    transformImpl = saved;
+}
+
+bool SelfTest(TransformFn fn) {
+    // Known answers (FIPS 180-2 examples)
+    static const struct {
+        const char* msg;
+        const char* digest;
+    } vectors[] = {
+        {"", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+        {"abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+    };
+
+    uint8_t digest[32];
+    for (const auto& v : vectors) {
+        DigestWith(fn, reinterpret_cast<const uint8_t*>(v.msg), strlen(v.msg), digest);
+        std::stringstream ss;
+        ss << std::hex << std::setfill('0');
+        for (int i = 0; i < 32; ++i) ss << std::setw(2) << (int)digest[i];
+        if (ss.str() != v.digest) return false;
+    }
+
+    // Cross-check against the portable code on multi-block inputs of every
+    // length around the block boundaries.
+    uint8_t msg[256];
+    for (size_t i = 0; i < sizeof(msg); ++i) msg[i] = static_cast<uint8_t>(i * 131 + 7);
+    for (size_t len = 0; len <= sizeof(msg); ++len) {
+        uint8_t expected[32];
+        DigestWith(TransformPortable, msg, len, expected);
+        DigestWith(fn, msg, len, digest);
+        if (memcmp(expected, digest, 32) != 0) return false;
+    }
+    return true;
+}
+
+// Compare a lane kernel with a plain double-SHA256 of the equivalent 80-byte
+// headers, including nonces that wrap around 2^32.
+bool SelfTestHeaderNonces(HeaderNoncesFn fn, size_t lanes) {
+    uint8_t header[80];
+    for (size_t i = 0; i < sizeof(header); ++i) header[i] = static_cast<uint8_t>(i * 29 + 3);
+    uint32_t midstate[8];
+    sha256::Initialize(midstate);
+    TransformPortable(midstate, header, 1);
+    uint32_t tail[3];
+    for (int i = 0; i < 3; ++i) tail[i] = ReadBE32(header + 64 + i * 4);
+
+    const uint32_t starts[] = {0, 0x12345678, 0xFFFFFFFF - 5};
+    for (uint32_t start : starts) {
+        uint32_t out0[16];
+        fn(out0, midstate, tail, start);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            uint32_t nonce = start + static_cast<uint32_t>(lane);
+            header[76] = static_cast<uint8_t>(nonce);
+            header[77] = static_cast<uint8_t>(nonce >> 8);
+            header[78] = static_cast<uint8_t>(nonce >> 16);
+            header[79] = static_cast<uint8_t>(nonce >> 24);
+            uint8_t expected[32];
+            DigestWith(TransformPortable, header, sizeof(header), expected);
+            DigestWith(TransformPortable, expected, sizeof(expected), expected);
+            if (out0[lane] != ReadBE32(expected)) return false;
+        }
+    }
+    return true;
+}
+
+// Nanoseconds per nonce, measured over a short fixed run.
+double TimeHeaderNonces(HeaderNoncesFn fn, size_t lanes) {
+    const uint32_t midstate[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    const uint32_t tail[3] = {9, 10, 11};
+    uint32_t out0[16];
+    const uint32_t nonces = 1 << 14;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < nonces; n += static_cast<uint32_t>(lanes)) fn(out0, midstate, tail, n);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / nonces;
+}
+
+} // namespace
+
+std::string SHA256AutoDetect() {
+    std::string desc = "standard";
+    transformImpl = TransformPortable;
+    headerNoncesImpl = HashHeaderNonceScalar;
+    headerNonceLanes = 1;
+    if (!SelfTest(TransformPortable)) {
+        throw std::runtime_error("SHA256 self-test failed for the portable implementation");
+    }
+
+#if defined(USE_CPU_DISPATCH)
+    bool haveSsse3 = false, haveSse41 = false, haveAvx = false, haveShani = false, haveAvx2 = false, haveAvx512 = false;
+    uint32_t eax, ebx, ecx, edx;
+    CpuId(0, 0, eax, ebx, ecx, edx);
+    uint32_t maxLeaf = eax;
+    if (maxLeaf >= 1) {
+        CpuId(1, 0, eax, ebx, ecx, edx);
+        haveSsse3 = (ecx >> 9) & 1;
+        haveSse41 = (ecx >> 19) & 1;
+        bool osxsave = (ecx >> 27) & 1;
+        uint64_t xcr0 = osxsave ? XGetBV() : 0;
+        haveAvx = osxsave && ((ecx >> 28) & 1) && (xcr0 & 0x6) == 0x6;
+        if (maxLeaf >= 7) {
+            CpuId(7, 0, eax, ebx, ecx, edx);
+            haveShani = (ebx >> 29) & 1;
+            haveAvx2 = haveAvx && ((ebx >> 5) & 1);
+            haveAvx512 = haveAvx && ((ebx >> 16) & 1) && (xcr0 & 0xE6) == 0xE6;
+        }
+    }
+    // Not every flag is consulted in every build configuration
+    (void)haveSsse3; (void)haveSse41; (void)haveShani; (void)haveAvx2; (void)haveAvx512;
+
+#if defined(ENABLE_SHANI)
+    if (haveShani && haveSse41 && haveSsse3) {
+        if (SelfTest(sha256_shani::Transform)) {
+            transformImpl = sha256_shani::Transform;
+            desc = "shani(1way)";
+        } else {
+            desc += " (shani self-test failed)";
+        }
+    }
+#endif
+
+    // Header nonce scanning: time every working candidate (the single-stream
+    // path included) and keep the fastest, since SHA-NI can beat wide SIMD
+    // lanes on some microarchitectures and lose on others.
+    struct Candidate {
+        const char* name;
+        HeaderNoncesFn fn;
+        size_t lanes;
+    };
+    std::vector<Candidate> candidates;
+#if defined(ENABLE_SSE41)
+    if (haveSse41) candidates.push_back({"sse41(4way)", sha256_sse41::HashHeaderNonces, 4});
+#endif
+#if defined(ENABLE_AVX2)
+    if (haveAvx2) candidates.push_back({"avx2(8way)", sha256_avx2::HashHeaderNonces, 8});
+#endif
+#if defined(ENABLE_AVX512)
+    if (haveAvx512) candidates.push_back({"avx512(16way)", sha256_avx512::HashHeaderNonces, 16});
+#endif
+    std::string laneDesc;
+    double best = TimeHeaderNonces(HashHeaderNonceScalar, 1);
+    for (const auto& c : candidates) {
+        if (!SelfTestHeaderNonces(c.fn, c.lanes)) {
+            desc += std::string(" (") + c.name + " self-test failed)";
+            continue;
+        }
+        double t = TimeHeaderNonces(c.fn, c.lanes);
+        if (t < best) {
+            best = t;
+            headerNoncesImpl = c.fn;
+            headerNonceLanes = c.lanes;
+            laneDesc = c.name;
+        }
+    }
+    if (!laneDesc.empty()) desc += ", header scan " + laneDesc;
+#endif
+
+    return desc;
+}
+
 } // namespace aurelis
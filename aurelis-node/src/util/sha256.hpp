@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 namespace aurelis {
 
@@ -13,30 +14,50 @@ public:
     void Update(const uint8_t* data, size_t len);
     void Update(const std::string& str);
     void Final(uint8_t* digest);
-    
+    SHA256& Reset();
+
     // Convenience
     static std::string HashToString(const std::string& input);
     static std::vector<uint8_t> Hash(const std::vector<uint8_t>& input);
 
 private:
-    uint8_t data[64];
-    uint32_t datalen;
-    uint64_t bitlen;
     uint32_t state[8];
-    
-    void Transform();
+    uint8_t data[64];
+    uint64_t bytes;
 };
 
+namespace sha256 {
+
+// Compression function entry point. Dispatches to the backend chosen by
+// SHA256AutoDetect() (portable code until then).
+void Initialize(uint32_t* state);
+void Transform(uint32_t* state, const uint8_t* chunk, size_t blocks);
+
+// Lane-parallel double-SHA256 for proof-of-work scanning. Hashes the 80-byte
+// headers with first-chunk midstate `midstate`, big-endian tail words
+// `tail[0..2]` (header bytes 64..75) and nonces nonce, nonce + 1, ...,
+// writing word 0 of each final state to out0. Handles HeaderNonceLanes()
+// nonces per call (1 without a SIMD backend); out0 must hold 16 words.
+size_t HeaderNonceLanes();
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce);
+
+} // namespace sha256
+
+// Probe the CPU, self-test the fastest available backend against the portable
+// implementation and install it. Call once at startup before any worker threads
+// are spawned. Returns a short description of the selected backend.
+std::string SHA256AutoDetect();
+
 // Double SHA256 (Hash256) used in Bitcoin/Aurelis
 inline void Hash256(const uint8_t* input, size_t len, uint8_t* output32) {
     SHA256 ctx;
     ctx.Update(input, len);
     uint8_t intermediate[32];
     ctx.Final(intermediate);
-    
-    SHA256 ctx2;
-    ctx2.Update(intermediate, 32);
-    ctx2.Final(output32);
+
+    ctx.Reset();
+    ctx.Update(intermediate, 32);
+    ctx.Final(output32);
 }
 
 } // namespace aurelis
@@ -0,0 +1,40 @@
+// 8-way lane-parallel header hashing using AVX2.
+// Built with -mavx2 and only called after SHA256AutoDetect() has confirmed
+// CPU support.
+
+#if defined(ENABLE_AVX2)
+
+#include "util/sha256_lanes.hpp"
+#include <immintrin.h>
+
+namespace aurelis {
+namespace sha256_avx2 {
+
+namespace {
+
+struct Ops {
+    typedef __m256i V;
+    static const size_t LANES = 8;
+
+    static V Set1(uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    static V Load(const uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void Store(uint32_t* p, V x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+    static V Add(V a, V b) { return _mm256_add_epi32(a, b); }
+    static V Xor(V a, V b) { return _mm256_xor_si256(a, b); }
+    static V And(V a, V b) { return _mm256_and_si256(a, b); }
+    static V Or(V a, V b) { return _mm256_or_si256(a, b); }
+    static V AndNot(V a, V b) { return _mm256_andnot_si256(a, b); }
+    template <int N> static V Shr(V x) { return _mm256_srli_epi32(x, N); }
+    template <int N> static V Ror(V x) { return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N)); }
+};
+
+} // namespace
+
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce) {
+    HashHeaderNoncesImpl<Ops>(out0, midstate, tail, nonce);
+}
+
+} // namespace sha256_avx2
+} // namespace aurelis
+
+#endif // ENABLE_AVX2
@@ -0,0 +1,44 @@
+// 16-way lane-parallel header hashing using AVX-512F.
+// Built with -mavx512f and only called after SHA256AutoDetect() has confirmed
+// CPU and OS support.
+
+#if defined(ENABLE_AVX512)
+
+#include "util/sha256_lanes.hpp"
+#include <immintrin.h>
+
+namespace aurelis {
+namespace sha256_avx512 {
+
+namespace {
+
+// Zero-masking forms with a full mask: same instructions, but they avoid the
+// _mm512_undefined_epi32() operand that trips -Wuninitialized on GCC 12.
+const __mmask16 ALL = 0xFFFF;
+
+struct Ops {
+    typedef __m512i V;
+    static const size_t LANES = 16;
+
+    static V Set1(uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    static V Load(const uint32_t* p) { return _mm512_load_si512(p); }
+    static void Store(uint32_t* p, V x) { _mm512_storeu_si512(p, x); }
+    static V Add(V a, V b) { return _mm512_add_epi32(a, b); }
+    static V Xor(V a, V b) { return _mm512_xor_si512(a, b); }
+    static V And(V a, V b) { return _mm512_and_si512(a, b); }
+    static V Or(V a, V b) { return _mm512_or_si512(a, b); }
+    static V AndNot(V a, V b) { return _mm512_maskz_andnot_epi32(ALL, a, b); }
+    template <int N> static V Shr(V x) { return _mm512_maskz_srli_epi32(ALL, x, N); }
+    template <int N> static V Ror(V x) { return _mm512_maskz_ror_epi32(ALL, x, N); }
+};
+
+} // namespace
+
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce) {
+    HashHeaderNoncesImpl<Ops>(out0, midstate, tail, nonce);
+}
+
+} // namespace sha256_avx512
+} // namespace aurelis
+
+#endif // ENABLE_AVX512
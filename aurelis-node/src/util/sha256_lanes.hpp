@@ -0,0 +1,108 @@
+#pragma once
+
+// Lane-parallel double-SHA256 of block headers that differ only in nonce.
+//
+// Shared by the SSE4.1, AVX2 and AVX-512 translation units: each one defines
+// an Ops struct over its vector type and instantiates HashHeaderNonces with
+// its own instruction set flags. Only include from those files.
+
+#include <cstdint>
+#include <cstddef>
+
+namespace aurelis {
+namespace {
+
+const uint32_t LANE_K[64] = {
+    0x428a2f98,0x71374491,0xb5c0fbcf,0xe9b5dba5,0x3956c25b,0x59f111f1,0x923f82a4,0xab1c5ed5,
+    0xd807aa98,0x12835b01,0x243185be,0x550c7dc3,0x72be5d74,0x80deb1fe,0x9bdc06a7,0xc19bf174,
+    0xe49b69c1,0xefbe4786,0x0fc19dc6,0x240ca1cc,0x2de92c6f,0x4a7484aa,0x5cb0a9dc,0x76f988da,
+    0x983e5152,0xa831c66d,0xb00327c8,0xbf597fc7,0xc6e00bf3,0xd5a79147,0x06ca6351,0x14292967,
+    0x27b70a85,0x2e1b2138,0x4d2c6dfc,0x53380d13,0x650a7354,0x766a0abb,0x81c2c92e,0x92722c85,
+    0xa2bfe8a1,0xa81a664b,0xc24b8b70,0xc76c51a3,0xd192e819,0xd6990624,0xf40e3585,0x106aa070,
+    0x19a4c116,0x1e376c08,0x2748774c,0x34b0bcb5,0x391c0cb3,0x4ed8aa4a,0x5b9cca4f,0x682e6ff3,
+    0x748f82ee,0x78a5636f,0x84c87814,0x8cc70208,0x90befffa,0xa4506ceb,0xbef9a3f7,0xc67178f2
+};
+
+const uint32_t LANE_INIT[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline uint32_t LaneBswap32(uint32_t x) {
+    return (x >> 24) | ((x >> 8) & 0x0000ff00) | ((x << 8) & 0x00ff0000) | (x << 24);
+}
+
+// 64 rounds over the message in w (clobbered by the schedule). The caller
+// performs the feed-forward, so it can skip the words it does not need.
+template <typename Ops>
+inline void LaneRounds(typename Ops::V* s, typename Ops::V* w) {
+    typedef typename Ops::V V;
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+
+    for (int i = 0; i < 64; ++i) {
+        if (i >= 16) {
+            V w2 = w[(i - 2) & 15];
+            V w15 = w[(i - 15) & 15];
+            V sig1 = Ops::Xor(Ops::Xor(Ops::template Ror<17>(w2), Ops::template Ror<19>(w2)), Ops::template Shr<10>(w2));
+            V sig0 = Ops::Xor(Ops::Xor(Ops::template Ror<7>(w15), Ops::template Ror<18>(w15)), Ops::template Shr<3>(w15));
+            w[i & 15] = Ops::Add(Ops::Add(w[i & 15], sig1), Ops::Add(w[(i - 7) & 15], sig0));
+        }
+        V ep1 = Ops::Xor(Ops::Xor(Ops::template Ror<6>(e), Ops::template Ror<11>(e)), Ops::template Ror<25>(e));
+        V ch = Ops::Xor(Ops::And(e, f), Ops::AndNot(e, g));
+        V t1 = Ops::Add(Ops::Add(Ops::Add(h, ep1), Ops::Add(ch, Ops::Set1(LANE_K[i]))), w[i & 15]);
+        V ep0 = Ops::Xor(Ops::Xor(Ops::template Ror<2>(a), Ops::template Ror<13>(a)), Ops::template Ror<22>(a));
+        V maj = Ops::Or(Ops::And(a, b), Ops::And(c, Ops::Or(a, b)));
+        V t2 = Ops::Add(ep0, maj);
+        h = g;
+        g = f;
+        f = e;
+        e = Ops::Add(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = Ops::Add(t1, t2);
+    }
+
+    s[0] = a; s[1] = b; s[2] = c; s[3] = d; s[4] = e; s[5] = f; s[6] = g; s[7] = h;
+}
+
+// For Ops::LANES consecutive nonces starting at `nonce`, writes word 0 of the
+// final double-SHA256 state to out0[lane]. `midstate` is the state after the
+// first 64 header bytes; `tail` holds the three big-endian words preceding
+// the nonce in the second chunk.
+template <typename Ops>
+void HashHeaderNoncesImpl(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce) {
+    typedef typename Ops::V V;
+
+    alignas(64) uint32_t nonces[Ops::LANES];
+    for (size_t i = 0; i < Ops::LANES; ++i) nonces[i] = LaneBswap32(nonce + static_cast<uint32_t>(i));
+
+    // First pass, second chunk: header bytes 64..79 plus padding (640 bits)
+    V w[16];
+    w[0] = Ops::Set1(tail[0]);
+    w[1] = Ops::Set1(tail[1]);
+    w[2] = Ops::Set1(tail[2]);
+    w[3] = Ops::Load(nonces);
+    w[4] = Ops::Set1(0x80000000);
+    for (int i = 5; i < 15; ++i) w[i] = Ops::Set1(0);
+    w[15] = Ops::Set1(640);
+
+    V s[8];
+    for (int i = 0; i < 8; ++i) s[i] = Ops::Set1(midstate[i]);
+    LaneRounds<Ops>(s, w);
+
+    // Second pass over the 32-byte digest (256 bits)
+    for (int i = 0; i < 8; ++i) w[i] = Ops::Add(s[i], Ops::Set1(midstate[i]));
+    w[8] = Ops::Set1(0x80000000);
+    for (int i = 9; i < 15; ++i) w[i] = Ops::Set1(0);
+    w[15] = Ops::Set1(256);
+
+    for (int i = 0; i < 8; ++i) s[i] = Ops::Set1(LANE_INIT[i]);
+    LaneRounds<Ops>(s, w);
+
+    // Only word 0 decides the target check; the rest of the digest is never
+    // materialized for non-winning lanes.
+    Ops::Store(out0, Ops::Add(s[0], Ops::Set1(LANE_INIT[0])));
+}
+
+} // namespace
+} // namespace aurelis
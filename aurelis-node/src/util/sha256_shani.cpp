@@ -0,0 +1,116 @@
+// SHA-256 compression using the Intel SHA extensions (SHA-NI).
+// Built with -msse4.1 -msha and only called after SHA256AutoDetect() has
+// confirmed CPU support.
+
+#if defined(ENABLE_SHANI)
+
+#include <cstdint>
+#include <cstddef>
+#include <immintrin.h>
+
+namespace aurelis {
+namespace sha256_shani {
+
+namespace {
+
+alignas(16) const uint8_t BSWAP_MASK[16] = {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12};
+
+inline __m128i Load(const uint8_t* in) {
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)),
+                            _mm_load_si128(reinterpret_cast<const __m128i*>(BSWAP_MASK)));
+}
+
+// Four rounds: k1:k0 hold the round constants for the quad as two packed words each.
+inline void QuadRound(__m128i& abef, __m128i& cdgh, __m128i msg, uint64_t k1, uint64_t k0) {
+    __m128i w = _mm_add_epi32(msg, _mm_set_epi64x(static_cast<long long>(k1), static_cast<long long>(k0)));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, w);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(w, 0x0E));
+}
+
+// m0 += sigma-terms completing the schedule for the quad after m1.
+inline void Schedule(__m128i& next, __m128i prev, __m128i cur) {
+    next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4)), cur);
+}
+
+} // namespace
+
+void Transform(uint32_t* s, const uint8_t* chunk, size_t blocks) {
+    // Repack ABCD/EFGH into the ABEF/CDGH layout used by sha256rnds2
+    __m128i abcd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    __m128i efgh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 4));
+    __m128i t1 = _mm_shuffle_epi32(abcd, 0xB1);
+    __m128i t2 = _mm_shuffle_epi32(efgh, 0x1B);
+    __m128i abef = _mm_alignr_epi8(t1, t2, 8);
+    __m128i cdgh = _mm_blend_epi16(t2, t1, 0xF0);
+
+    while (blocks--) {
+        const __m128i abefSave = abef;
+        const __m128i cdghSave = cdgh;
+
+        __m128i m0 = Load(chunk);
+        __m128i m1 = Load(chunk + 16);
+        __m128i m2 = Load(chunk + 32);
+        __m128i m3 = Load(chunk + 48);
+
+        QuadRound(abef, cdgh, m0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+        QuadRound(abef, cdgh, m1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        QuadRound(abef, cdgh, m2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        QuadRound(abef, cdgh, m3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+        Schedule(m0, m2, m3);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+
+        QuadRound(abef, cdgh, m0, 0x240ca1cc0fc19dc6ull, 0xefbe4786e49b69c1ull);
+        Schedule(m1, m3, m0);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        QuadRound(abef, cdgh, m1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+        Schedule(m2, m0, m1);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        QuadRound(abef, cdgh, m2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+        Schedule(m3, m1, m2);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        QuadRound(abef, cdgh, m3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+        Schedule(m0, m2, m3);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+
+        QuadRound(abef, cdgh, m0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+        Schedule(m1, m3, m0);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        QuadRound(abef, cdgh, m1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+        Schedule(m2, m0, m1);
+        m0 = _mm_sha256msg1_epu32(m0, m1);
+        QuadRound(abef, cdgh, m2, 0xc76c51a3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+        Schedule(m3, m1, m2);
+        m1 = _mm_sha256msg1_epu32(m1, m2);
+        QuadRound(abef, cdgh, m3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+        Schedule(m0, m2, m3);
+        m2 = _mm_sha256msg1_epu32(m2, m3);
+
+        QuadRound(abef, cdgh, m0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+        Schedule(m1, m3, m0);
+        m3 = _mm_sha256msg1_epu32(m3, m0);
+        QuadRound(abef, cdgh, m1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+        Schedule(m2, m0, m1);
+        QuadRound(abef, cdgh, m2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+        Schedule(m3, m1, m2);
+        QuadRound(abef, cdgh, m3, 0xc67178f2bef9a3f7ull, 0xa4506ceb90befffaull);
+
+        abef = _mm_add_epi32(abef, abefSave);
+        cdgh = _mm_add_epi32(cdgh, cdghSave);
+        chunk += 64;
+    }
+
+    // Back to ABCD/EFGH
+    t1 = _mm_shuffle_epi32(abef, 0x1B);
+    t2 = _mm_shuffle_epi32(cdgh, 0xB1);
+    abcd = _mm_blend_epi16(t1, t2, 0xF0);
+    efgh = _mm_alignr_epi8(t2, t1, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s), abcd);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(s + 4), efgh);
+}
+
+} // namespace sha256_shani
+} // namespace aurelis
+
+#endif // ENABLE_SHANI
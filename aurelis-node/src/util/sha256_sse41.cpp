@@ -0,0 +1,40 @@
+// 4-way lane-parallel header hashing using SSE4.1.
+// Built with -msse4.1 and only called after SHA256AutoDetect() has confirmed
+// CPU support.
+
+#if defined(ENABLE_SSE41)
+
+#include "util/sha256_lanes.hpp"
+#include <immintrin.h>
+
+namespace aurelis {
+namespace sha256_sse41 {
+
+namespace {
+
+struct Ops {
+    typedef __m128i V;
+    static const size_t LANES = 4;
+
+    static V Set1(uint32_t x) { return _mm_set1_epi32(static_cast<int>(x)); }
+    static V Load(const uint32_t* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void Store(uint32_t* p, V x) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x); }
+    static V Add(V a, V b) { return _mm_add_epi32(a, b); }
+    static V Xor(V a, V b) { return _mm_xor_si128(a, b); }
+    static V And(V a, V b) { return _mm_and_si128(a, b); }
+    static V Or(V a, V b) { return _mm_or_si128(a, b); }
+    static V AndNot(V a, V b) { return _mm_andnot_si128(a, b); }
+    template <int N> static V Shr(V x) { return _mm_srli_epi32(x, N); }
+    template <int N> static V Ror(V x) { return _mm_or_si128(_mm_srli_epi32(x, N), _mm_slli_epi32(x, 32 - N)); }
+};
+
+} // namespace
+
+void HashHeaderNonces(uint32_t* out0, const uint32_t* midstate, const uint32_t* tail, uint32_t nonce) {
+    HashHeaderNoncesImpl<Ops>(out0, midstate, tail, nonce);
+}
+
+} // namespace sha256_sse41
+} // namespace aurelis
+
+#endif // ENABLE_SSE41
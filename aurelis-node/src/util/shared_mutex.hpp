@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex> // std::shared_lock
+
+namespace aurelis {
+
+// Reader/writer lock that lets a waiting writer in ahead of new readers.
+//
+// std::shared_mutex on glibc prefers readers, so a steady stream of
+// overlapping queries can hold off a writer indefinitely. Here a writer
+// announces itself first; readers arriving after that wait until it is
+// done, and the writer only waits for the readers already inside. Usable
+// with std::unique_lock and std::shared_lock.
+class SharedMutex {
+public:
+    SharedMutex() : readers(0), writersWaiting(0), writing(false) {}
+
+    SharedMutex(const SharedMutex&) = delete;
+    SharedMutex& operator=(const SharedMutex&) = delete;
+
+    void lock() {
+        std::unique_lock<std::mutex> guard(mtx);
+        writersWaiting++;
+        writerGate.wait(guard, [this] { return !writing && readers == 0; });
+        writersWaiting--;
+        writing = true;
+    }
+
+    void unlock() {
+        std::lock_guard<std::mutex> guard(mtx);
+        writing = false;
+        if (writersWaiting > 0) writerGate.notify_one();
+        readerGate.notify_all();
+    }
+
+    void lock_shared() {
+        std::unique_lock<std::mutex> guard(mtx);
+        readerGate.wait(guard, [this] { return !writing && writersWaiting == 0; });
+        readers++;
+    }
+
+    void unlock_shared() {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (--readers == 0 && writersWaiting > 0) writerGate.notify_one();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable readerGate;
+    std::condition_variable writerGate;
+    unsigned readers;
+    unsigned writersWaiting;
+    bool writing;
+};
+
+} // namespace aurelis
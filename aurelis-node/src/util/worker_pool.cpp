@@ -0,0 +1,71 @@
+#include "util/worker_pool.hpp"
+#include <algorithm>
+
+namespace aurelis {
+
+WorkerPool::WorkerPool(int threads)
+    : stopping(false), generation(0), pending(0), job(nullptr), jobCount(0), jobGrain(1), cursor(0) {
+    for (int i = 1; i < threads; ++i) workers.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void WorkerPool::RunChunks() {
+    for (;;) {
+        size_t begin = cursor.fetch_add(jobGrain, std::memory_order_relaxed);
+        if (begin >= jobCount) return;
+        (*job)(begin, std::min(begin + jobGrain, jobCount));
+    }
+}
+
+void WorkerPool::WorkerLoop() {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        RunChunks();
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--pending == 0) done.notify_one();
+    }
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    // Not worth waking anyone for a single chunk
+    if (workers.empty() || count <= grain) {
+        fn(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(callMutex);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        job = &fn;
+        jobCount = count;
+        jobGrain = grain;
+        cursor.store(0, std::memory_order_relaxed);
+        pending = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    RunChunks();
+
+    // Every worker must check in before `fn` goes out of scope
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [&] { return pending == 0; });
+    job = nullptr;
+}
+
+} // namespace aurelis
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace aurelis {
+
+// Fixed set of threads that split index ranges with the calling thread.
+//
+// ParallelFor hands out [begin, end) chunks of `grain` indices from a shared
+// cursor, so uneven work balances itself, and returns once every index has
+// been processed. One job runs at a time; concurrent callers queue up. A pool
+// of one thread spawns nothing and runs every job inline.
+class WorkerPool {
+public:
+    // `threads` counts the caller, so threads - 1 workers are started
+    explicit WorkerPool(int threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int Threads() const { return (int)workers.size() + 1; }
+
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& fn);
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex callMutex; // one job at a time
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping;
+    uint64_t generation; // bumped per job so each worker joins it once
+    size_t pending;      // workers that have not finished the current job
+
+    const std::function<void(size_t, size_t)>* job;
+    size_t jobCount;
+    size_t jobGrain;
+    std::atomic<size_t> cursor;
+
+    void WorkerLoop();
+    void RunChunks();
+};
+
+} // namespace aurelis